@@ -41,8 +41,10 @@ func makeImageBuffer(_ scaleFactor: Int) -> vImage_Buffer {
 }
 
 func redraw(user: UnsafeRawPointer?) {
-  let view = user!.bindMemory(to: PixelView.self, capacity: 1)
-  view[0].needsDisplay = true
+  let view = user!.bindMemory(to: PixelView.self, capacity: 1)[0]
+  DispatchQueue.main.asyncAfter(deadline: .now() + sysPaintDelay(view.sys)) {
+    view.needsDisplay = true
+  }
 }
 
 class PixelView: NSView {
@@ -116,6 +118,7 @@ class PixelView: NSView {
       let image = try imageBuffer.createCGImage(format: imageFormat)
       let context = NSGraphicsContext.current!.cgContext
       context.draw(image, in: dirtyRect)
+      sysPresented(sys)
 
       // Uncomment this to continuously re-render.
       // DispatchQueue.main.async {
@@ -0,0 +1,258 @@
+#include "canvas.hh"
+#include "edges.hh"
+#include "fill.hh"
+#include "list.hh"
+#include "math.hh"
+#include "shape.hh"
+#include "text.hh"
+#include "texture.hh"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Microbenchmarks for the kernels, run with
+//
+//   build/bench [--save baseline] [baseline [threshold]]
+//
+// Each case prints its name and the time per pixel, edge or primitive. With a
+// baseline written by --save, each case also prints its change, and the run
+// fails if any case is slower by more than `threshold` percent (10 by default).
+
+void blit_triangle(Canvas& canvas, Point a, Point b, Point c, Pixel color);
+void blit_pie(Canvas& canvas, Point center, float radius, Dir start, Dir end, Pixel color);
+void bezier(Canvas&, Point, Point, Point, Point, u32 steps, bool antialiased);
+
+namespace PW {
+
+void circle(Canvas& canvas, Point center, float radius, Pixel color);
+
+}
+
+namespace {
+
+using namespace PW;
+
+constexpr u32 width = 4096 + 128;
+constexpr u32 height = 256;
+
+struct Result {
+  char name[48];
+  double time;
+  char const* unit;
+};
+
+struct Baseline {
+  char name[48];
+  double time;
+};
+
+List<Result> results;
+
+// Repeats `body` until it has run for at least 20ms, and returns the time of
+// one call in nanoseconds.
+auto measure(auto const& body) -> double {
+  using namespace std::chrono;
+  body();
+  for (u32 count = 1;; count *= 2) {
+    auto start = steady_clock::now();
+    for (u32 k = 0; k < count; ++k)
+      body();
+    auto elapsed = duration<double, std::nano>(steady_clock::now() - start).count();
+    if (elapsed >= 2e7)
+      return elapsed / count;
+  }
+}
+
+void report(char const* unit, double time, char const* format, auto... args) {
+  Result result;
+  snprintf(result.name, sizeof(result.name), format, args...);
+  result.time = time;
+  result.unit = unit;
+  results.push(result);
+  printf("%-32s %10.3f ns/%s\n", result.name, time, unit);
+}
+
+// Spans of every length start at a different column on each row, so that
+// they don't all share an alignment.
+void bench_spans(Canvas& canvas, char const* name, auto const& fill) {
+  for (u32 n = 1; n <= 4096; n *= 2) {
+    auto time = measure([&] {
+      for (u32 i = 0; i < height; ++i) {
+        auto j0 = static_cast<int>(i * 37 % (width - n));
+        setrow(canvas, i, j0, j0 + n, fill);
+      }
+    });
+    report("pixel", time / (height * n), "setrow/%s/%u", name, n);
+  }
+}
+
+// A regular polygon with `count` sides around the canvas center. It is
+// convex, which keeps it within the renderer's limit on active edges.
+void make_polygon(AllEdges& edges, u32 count) {
+  edges = {};
+  auto fill = push_fill(edges, Solid {{255, 40, 80, 160}});
+  auto corner = [&](u32 k) {
+    auto dir = make_dir(6.2831853f * k / count + .01f);
+    return Point {128.f + 120.f * dir.x, 128.f + 120.f * dir.y};
+  };
+  for (u32 k = 0; k < count; ++k)
+    push_line(edges, corner(k), corner(k + 1), 0, fill);
+}
+
+bool load(List<Baseline>& baseline, char const* path) {
+  auto file = fopen(path, "r");
+  if (!file)
+    return false;
+  Baseline entry;
+  char unit[16];
+  while (fscanf(file, "%47s %lf ns/%15s", entry.name, &entry.time, unit) == 3)
+    baseline.push(entry);
+  fclose(file);
+  return true;
+}
+
+bool save(char const* path) {
+  auto file = fopen(path, "w");
+  if (!file)
+    return false;
+  for (auto const& result: results)
+    fprintf(file, "%s %.3f ns/%s\n", result.name, result.time, result.unit);
+  return !fclose(file);
+}
+
+// Returns the number of cases slower than the baseline by more than
+// `threshold` percent.
+u32 compare(List<Baseline> const& baseline, double threshold) {
+  u32 regressions = 0;
+  printf("\n%-32s %10s %10s %8s\n", "case", "baseline", "now", "change");
+  for (auto const& result: results) {
+    for (auto const& entry: baseline) {
+      if (strcmp(entry.name, result.name))
+        continue;
+      auto change = 100. * (result.time / entry.time - 1.);
+      auto slower = change > threshold;
+      regressions += slower;
+      printf("%-32s %10.3f %10.3f %+7.1f%%%s\n", result.name, entry.time, result.time, change, slower ? "  slower" : "");
+    }
+  }
+  return regressions;
+}
+
+}
+
+int main(int argc, char** argv) {
+  char const* save_path = nullptr;
+  char const* baseline_path = nullptr;
+  auto threshold = 10.;
+  for (auto k = 1; k < argc; ++k) {
+    if (!strcmp(argv[k], "--save") && k + 1 < argc)
+      save_path = argv[++k];
+    else if (!baseline_path)
+      baseline_path = argv[k];
+    else
+      threshold = atof(argv[k]);
+  }
+
+  List<Pixel> pixels;
+  pixels.resize(width * height);
+  for (auto& pixel: pixels)
+    pixel = {255, 255, 255, 255};
+  Canvas canvas {pixels.begin(), width, height, width};
+
+  // Sources for the fills that read other memory.
+  List<Pixel> source;
+  List<u8> coverage;
+  source.resize(width * height);
+  coverage.resize(width * height);
+  for (u32 k = 0; k < width * height; ++k) {
+    u8 alpha = k * 7 % 256;
+    source[k] = {alpha, static_cast<u8>(alpha / 2), 0, alpha};
+    coverage[k] = alpha;
+  }
+  Ramp ramp;
+  ColorStop stops[] {{0.f, {255, 255, 0, 0}}, {.5f, {128, 0, 255, 0}}, {1.f, {255, 0, 0, 255}}};
+  make_ramp(ramp, stops, 3);
+  Texture texture;
+  make_texture(texture, source.begin(), 256, 256, width);
+
+  Pixel color {255, 40, 80, 160};
+  Pixel translucent {160, 40, 80, 160};
+  bench_spans(canvas, "solid", Solid {color});
+  bench_spans(canvas, "linear", LinearGradient {translucent, {0.f, 0.f}, {.001f, .002f}});
+  bench_spans(canvas, "radial", RadialGradient {translucent, {2000.f, 128.f}, 10.f, 2000.f});
+  bench_spans(canvas, "linear-ramp", LinearRamp {&ramp, {0.f, 0.f}, {.001f, .002f}, Spread::repeat});
+  bench_spans(canvas, "radial-ramp", RadialRamp {&ramp, {2000.f, 128.f}, 10.f, 2000.f, Spread::reflect});
+  bench_spans(canvas, "pattern", Pattern {&texture, {0.f, 0.f}, {.7f, .1f}, {-.1f, .7f}, Spread::repeat, Sampling::bilinear});
+  bench_spans(canvas, "layer", LayerFill {source.begin(), width, 0, 0, 200});
+  bench_spans(canvas, "mask", MaskFill {coverage.begin(), width, 0, 0, color});
+  auto wide = make_gouraud({0.f, 0.f}, {float(width), 0.f}, {0.f, float(height)}, color, {255, 20, 200, 90}, {255, 240, 40, 10});
+  bench_spans(canvas, "gouraud", wide);
+  wide.colors[1] = translucent;
+  bench_spans(canvas, "gouraud-translucent", wide);
+
+  // The edge list is sorted by the first call, so later calls measure
+  // rendering an already sorted list.
+  AllEdges edges;
+  for (u32 count = 8; count <= AllEdges::max_edges; count *= 2) {
+    make_polygon(edges, count);
+    auto time = measure([&] { render(canvas, edges); });
+    report("edge", time / edges.count, "render/%u", count);
+  }
+
+  // Triangles of about size * size pixels, `aspect` times wider than tall.
+  for (auto size: {2.f, 8.f, 32.f, 128.f}) {
+    for (auto aspect: {1.f, 4.f, 16.f}) {
+      auto w = size * sqrt(aspect);
+      auto h = size / sqrt(aspect);
+      auto a = Point {64.3f, 100.6f};
+      auto time = measure([&] { blit_triangle(canvas, a, a + Point {w, .3f * h}, a + Point {.4f * w, h}, color); });
+      report("primitive", time, "triangle/%g/%g", size, aspect);
+      if (aspect != 1.f)
+        continue;
+      auto gouraud = measure([&] {
+        blit_triangle(canvas, a, a + Point {w, .3f * h}, a + Point {.4f * w, h}, color, translucent, {255, 240, 40, 10});
+      });
+      report("primitive", gouraud, "gouraud/%g", size);
+    }
+  }
+
+  for (auto radius: {2.f, 8.f, 32.f, 100.f}) {
+    auto center = Point {128.4f, 128.7f};
+    auto pie = measure([&] { blit_pie(canvas, center, radius, make_dir(.3f), make_dir(1.8f), color); });
+    report("primitive", pie, "pie/%g", radius);
+    auto circle = measure([&] { PW::circle(canvas, center, radius, color); });
+    report("primitive", circle, "circle/%g", radius);
+  }
+
+  for (auto size: {16.f, 64.f, 200.f}) {
+    auto a = Point {20.f, 20.f};
+    auto time = measure([&] {
+      bezier(canvas, a, a + Point {size, 0.f}, a + Point {0.f, size}, a + Point {size, size}, 64, true);
+    });
+    report("primitive", time, "bezier/%g", size);
+  }
+
+  // Text runs from a warm glyph cache.
+  GlyphCache glyphs;
+  char const text[] = "The quick brown fox 0123456789";
+  for (auto size: {12.f, 32.f}) {
+    auto time = measure([&] { draw_text(canvas, glyphs, text, {10.f, 100.f}, size, color); });
+    report("glyph", time / (sizeof(text) - 1), "text/%g", size);
+  }
+
+  if (save_path && !save(save_path)) {
+    fprintf(stderr, "can't write %s\n", save_path);
+    return 1;
+  }
+  if (!baseline_path)
+    return 0;
+  List<Baseline> baseline;
+  if (!load(baseline, baseline_path)) {
+    fprintf(stderr, "can't read %s\n", baseline_path);
+    return 1;
+  }
+  return compare(baseline, threshold) ? 1 : 0;
+}
@@ -1,4 +1,5 @@
 #include "canvas.hh"
+#include "polygon.hh"
 
 #include <cmath>
 #include <cstdio>
@@ -23,7 +24,10 @@ struct Section {
 
 }
 
-void bezier(Canvas& canvas, Point p0, Point p1, Point p2, Point p3) {
+// Draws the curve in `steps` straight pieces, at most 128. Without
+// antialiasing, each piece is one solid quad as wide as the curve's coverage,
+// and there are no caps.
+void bezier(Canvas& canvas, Point p0, Point p1, Point p2, Point p3, u32 steps, bool antialiased) {
   auto P0 = p0;
   auto P1 = (p1 - p0) * 3.f;
   auto P2 = (p0 - p1 * 2.f + p2) * 3.f;
@@ -41,10 +45,19 @@ void bezier(Canvas& canvas, Point p0, Point p1, Point p2, Point p3) {
     return {center + normal * thickness, center, center - normal * thickness};
   };
 
+  // Each step adds a quad on either side of the curve.
+  PW::Polygons strip;
   auto last = eval(0.f);
-  auto dt = pow(.5f, 6.f);
+  auto dt = 1.f / steps;
   for (auto T = dt; T <= 1.f; T += dt) {
     auto next = eval(T);
+    if (!antialiased) {
+      auto half = [](Point edge, Point center) { return (edge + center) * .5f; };
+      Point quad[] {half(last.p[0], last.p[1]), half(last.p[2], last.p[1]), half(next.p[2], next.p[1]), half(next.p[0], next.p[1])};
+      push_polygon(strip, quad, 4, Solid {color});
+      last = next;
+      continue;
+    }
     auto avg = Section {
       (last.p[0] + next.p[0]) * .5f,
       (last.p[1] + next.p[1]) * .5f,
@@ -53,12 +66,15 @@ void bezier(Canvas& canvas, Point p0, Point p1, Point p2, Point p3) {
     auto d1 = avg.p[2] - avg.p[1];
     auto gradient0 = LinearGradient {color, avg.p[1], d0 / abs2(d0)};
     auto gradient1 = LinearGradient {color, avg.p[1], d1 / abs2(d1)};
-    blit_triangle(canvas, last.p[0], last.p[1], next.p[0], gradient0);
-    blit_triangle(canvas, next.p[1], last.p[1], next.p[0], gradient0);
-    blit_triangle(canvas, last.p[1], last.p[2], next.p[1], gradient1);
-    blit_triangle(canvas, next.p[2], last.p[2], next.p[1], gradient1);
+    Point upper[] {last.p[0], last.p[1], next.p[1], next.p[0]};
+    Point lower[] {last.p[1], last.p[2], next.p[2], next.p[1]};
+    push_polygon(strip, upper, 4, gradient0);
+    push_polygon(strip, lower, 4, gradient1);
     last = next;
   }
+  blit_polygons(canvas, strip);
+  if (!antialiased)
+    return;
 
   {
     auto heading = dir(p0 - p1);
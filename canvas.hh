@@ -1,6 +1,7 @@
 #pragma once
 
 using u8 = unsigned char;
+using u16 = unsigned short;
 using u32 = unsigned int;
 
 struct Pixel {
@@ -12,11 +13,78 @@ struct Pixel {
   u8& operator[](u32 i) { return (&alpha)[i]; }
 };
 
+struct RowExtent {
+  u32 begin;
+  u32 end;
+};
+
+// Front-to-back mode. `owner` holds, per pixel, the front-most layer whose
+// opaque fill covers it, or 0; `rows` bounds the owned pixels of each row.
+// A layer is a primitive: its scene step in the high bits, and its order
+// within the step in the low `primitive_bits`, so later primitives are in
+// front. Primitives past the last index of a step share it.
+struct Occlusion {
+  enum { primitive_bits = 11, max_primitive = (1 << primitive_bits) - 1 };
+  u16* owner;
+  RowExtent* rows;
+  u32 stride;
+  u16 layer;
+  bool opaque_pass;
+};
+
+// Render counters. `hits`, when set, counts writes per pixel (saturating) so
+// that pixels written more than once can be counted and shown.
+struct Stats {
+  enum { max_fill_types = 16 };
+  u32 primitives;
+  u32 edges;
+  u32 spans;
+  u32 pixels[max_fill_types];
+  u32 overdrawn;
+  u8* hits;
+  u32 stride;
+};
+
+namespace PW {
+struct Tiles;
+struct Capture;
+struct DrawList;
+}
+
+struct Rect {
+  int x0, y0, x1, y1;
+};
+
+struct ClipStack {
+  enum { max_depth = 8 };
+  Rect saved[max_depth];
+  u32 depth;
+};
+
 struct Canvas {
   Pixel* data;
   u32 width;
   u32 height;
   u32 stride;
+  Occlusion* occlusion {};
+  Stats* stats {};
+  PW::Tiles* tiles {};
+  PW::Capture* capture {};
+  PW::DrawList* draw_list {};
+  Rect clip {0, 0, static_cast<int>(width), static_cast<int>(height)};
+  ClipStack clips {};
+  // Pixel (i, j) is stored at data[(i - top) * stride + j - left]. Layers and
+  // strips set these, their buffers only cover their bounds.
+  int left {};
+  int top {};
+  // Rasterize lines and triangles in fixed point, see fixed.hh.
+  bool fixed_point {};
+  // Blend in linear light rather than on the stored sRGB bytes.
+  bool gamma_correct {};
+
+  Pixel& at(int i, int j) const {
+    return data[(i - top) * static_cast<int>(stride) + j - left];
+  }
 };
 
 struct Point {
@@ -51,6 +119,83 @@ struct Solid {
   Pixel color;
 };
 
+enum class Spread : u8 { pad, repeat, reflect };
+
+struct ColorStop {
+  float offset;
+  Pixel color;
+};
+
+struct Ramp {
+  enum { size = 256 };
+  Pixel color[size];
+};
+
+void make_ramp(Ramp& ramp, ColorStop const* stops, u32 count);
+
+struct LinearRamp {
+  enum { fill_type = 3 };
+  Ramp const* ramp;
+  Point position;
+  Point direction;
+  Spread spread;
+};
+
+struct RadialRamp {
+  enum { fill_type = 4 };
+  Ramp const* ramp;
+  Point center;
+  float start_radius;
+  float thickness;
+  Spread spread;
+};
+
+enum class Sampling : u8 { nearest, bilinear };
+
+struct Texture;
+
+// The pixel centered at p samples the texture at origin + p.x * dx + p.y * dy,
+// in texels of the texture's first level.
+struct Pattern {
+  enum { fill_type = 5 };
+  Texture const* texture;
+  Point origin;
+  Point dx;
+  Point dy;
+  Spread spread;
+  Sampling sampling;
+};
+
+// Composites a layer's premultiplied pixels, see layer.hh.
+struct LayerFill {
+  enum { fill_type = 6 };
+  Pixel const* data;
+  u32 stride;
+  int left;
+  int top;
+  u8 opacity;
+};
+
+// Blends `color` through an 8-bit coverage mask, see shadow.hh.
+struct MaskFill {
+  enum { fill_type = 7 };
+  u8 const* data;
+  u32 stride;
+  int left;
+  int top;
+  Pixel color;
+};
+
+// Interpolates the colors at a triangle's corners. At the pixel centered at p,
+// colors[1] and colors[2] weigh u[0] * p.x + u[1] * p.y + u[2] and the same
+// with v, and colors[0] the rest, see blit_triangle.
+struct Gouraud {
+  enum { fill_type = 8 };
+  Pixel colors[3];
+  float u[3];
+  float v[3];
+};
+
 struct Dir {
   float x, y;
   Point operator*(float scale) { return {x * scale, y * scale}; }
@@ -76,6 +221,12 @@ struct Size {
 
 void blit_triangle(Canvas& canvas, Point a, Point b, Point c, Pixel color);
 void blit_triangle(Canvas& canvas, Point a, Point b, Point c, LinearGradient const& fill);
+void blit_triangle(Canvas& canvas, Point a, Point b, Point c, Pixel color_a, Pixel color_b, Pixel color_c);
+// Maps the texture affinely, with texel coordinates given at each corner.
+void blit_triangle(Canvas& canvas, Point a, Point b, Point c, Texture const& texture, Point texel_a, Point texel_b, Point texel_c);
+// The fill of a triangle with a color at each corner, to draw it among
+// other polygons. A triangle without area gets weights of 0.
+auto make_gouraud(Point a, Point b, Point c, Pixel color_a, Pixel color_b, Pixel color_c) -> Gouraud;
 
 template <class T>
 T const& max(T const& a, T const& b) { return (a < b) ? b : a; }
@@ -87,6 +238,9 @@ namespace PW {
 
 void point(Canvas& canvas, Point point);
 
+void push_clip(Canvas& canvas, Rect rect);
+void pop_clip(Canvas& canvas);
+
 inline auto cross(Dir a, Dir b) { return a.x * b.y - a.y * b.x; }
 
 }
@@ -0,0 +1,272 @@
+#include "capture.hh"
+#include "fill.hh"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace PW {
+
+namespace {
+
+constexpr u32 align(u32 offset) { return (offset + 7) & ~7u; }
+
+bool by_value(u8 fill_type) {
+  return fill_type == Solid::fill_type || fill_type == LinearGradient::fill_type ||
+    fill_type == RadialGradient::fill_type || fill_type == Gouraud::fill_type;
+}
+
+// Appends `size` bytes to the payload and returns their offset.
+u32 append(Capture& capture, void const* data, u32 size) {
+  auto offset = align(len(capture.payload));
+  capture.payload.resize(offset + size);
+  memcpy(&capture.payload[offset], data, size);
+  return offset;
+}
+
+u32 find_fill(Capture& capture, u8 fill_type, FillData const& fill) {
+  auto count = len(capture.fills);
+  if (count && capture.fill_types[count - 1] == fill_type && !memcmp(&capture.fills[count - 1], &fill, sizeof(FillData)))
+    return count - 1;
+  capture.fills.push(fill);
+  capture.fill_types.push(fill_type);
+  return count;
+}
+
+template <class T>
+auto at(void const* data, u32 offset) -> T const* {
+  return reinterpret_cast<T const*>(static_cast<char const*>(data) + offset);
+}
+
+// Whether `count` items of `size` bytes at `offset` fit within `limit`, at an
+// 8-byte aligned offset.
+bool fits(u32 offset, uint64_t count, uint64_t size, uint64_t limit) {
+  return offset % 8 == 0 && offset + count * size <= limit;
+}
+
+bool valid_edges(AllEdges const& edges) {
+  if (edges.count > AllEdges::max_edges || edges.fill_count > AllEdges::max_fills)
+    return false;
+  for (u32 k = 0; k < edges.fill_count; ++k)
+    if (!by_value(edges.fill_type[k]))
+      return false;
+  for (u32 k = 0; k < edges.count; ++k) {
+    if (edges.type[k] > RightArc::edge_type || edges.fill[k] > edges.fill_count)
+      return false;
+    if (edges.winding[k] && !edges.fill[k])
+      return false;
+  }
+  for (u32 k = 0; k < 2 * edges.count; ++k)
+    if (edges.lim[k].edge >= edges.count)
+      return false;
+  return true;
+}
+
+// Checks every table and record against the capture's size and the tables
+// they index, so that replay can trust them.
+bool valid(void const* data, size_t size) {
+  if (size < sizeof(CaptureHeader))
+    return false;
+  auto const& header = *at<CaptureHeader>(data, 0);
+  if (header.magic_number != CaptureHeader::magic || header.version_number != CaptureHeader::version)
+    return false;
+  if (header.size > size || header.payload > header.size)
+    return false;
+  if (!fits(header.fills, header.fill_count, sizeof(FillData), header.size) ||
+      !fits(header.fill_types, header.fill_count, 1, header.size) ||
+      !fits(header.records, header.record_count, sizeof(CaptureRecord), header.size) ||
+      !fits(header.payload, 0, 0, header.size))
+    return false;
+
+  auto fill_types = at<u8>(data, header.fill_types);
+  for (u32 k = 0; k < header.fill_count; ++k)
+    if (!by_value(fill_types[k]))
+      return false;
+
+  auto records = at<CaptureRecord>(data, header.records);
+  auto payload = static_cast<char const*>(data) + header.payload;
+  auto payload_size = header.size - header.payload;
+  for (u32 k = 0; k < header.record_count; ++k) {
+    auto const& record = records[k];
+    switch (record.kind) {
+      case CaptureRecord::clear:
+        if (!fits(record.offset, 1, sizeof(Pixel), payload_size))
+          return false;
+        break;
+      case CaptureRecord::edges:
+        if (!fits(record.offset, 1, sizeof(AllEdges), payload_size) || !valid_edges(*at<AllEdges>(payload, record.offset)))
+          return false;
+        break;
+      case CaptureRecord::spans: {
+        if (!fits(record.offset, record.count, sizeof(CaptureSpan), payload_size))
+          return false;
+        auto spans = at<CaptureSpan>(payload, record.offset);
+        for (u32 s = 0; s < record.count; ++s)
+          if (spans[s].fill >= header.fill_count)
+            return false;
+        break;
+      }
+      case CaptureRecord::pixels: {
+        if (!fits(record.offset, 1, sizeof(CaptureSpan), payload_size))
+          return false;
+        auto const& span = *at<CaptureSpan>(payload, record.offset);
+        if (span.begin > span.end || !fits(record.offset + sizeof(CaptureSpan), uint64_t(span.end) - span.begin, sizeof(Pixel), payload_size))
+          return false;
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+}
+
+void begin(Capture& capture, Canvas const& canvas) {
+  capture.width = canvas.width;
+  capture.height = canvas.height;
+  capture.fills.clear();
+  capture.fill_types.clear();
+  capture.records.clear();
+  capture.payload.clear();
+}
+
+void record_clear(Capture& capture, Pixel color) {
+  capture.records.push({CaptureRecord::clear, 1, append(capture, &color, sizeof(color)), 0});
+}
+
+bool record_edges(Capture& capture, AllEdges const& edges) {
+  for (u32 k = 0; k < edges.fill_count; ++k)
+    if (!by_value(edges.fill_type[k]))
+      return false;
+  capture.records.push({CaptureRecord::edges, 1, append(capture, &edges, sizeof(AllEdges)), 0});
+  return true;
+}
+
+void record_span(Capture& capture, Canvas const& canvas, u32 i, u32 j0, u32 j1, u8 fill_type, FillData const& fill) {
+  auto span = CaptureSpan {static_cast<int>(i), static_cast<int>(j0), static_cast<int>(j1), 0};
+  if (!by_value(fill_type)) {
+    auto offset = append(capture, &span, sizeof(span));
+    append(capture, &canvas.at(i, j0), (j1 - j0) * sizeof(Pixel));
+    capture.records.push({CaptureRecord::pixels, 1, offset, 0});
+    return;
+  }
+
+  span.fill = find_fill(capture, fill_type, fill);
+  // Spans extend the last record while nothing else has been appended.
+  auto count = len(capture.records);
+  if (count) {
+    auto& last = capture.records[count - 1];
+    if (last.kind == CaptureRecord::spans && last.offset + last.count * sizeof(CaptureSpan) == len(capture.payload)) {
+      append(capture, &span, sizeof(span));
+      last.count += 1;
+      return;
+    }
+  }
+  capture.records.push({CaptureRecord::spans, 1, append(capture, &span, sizeof(span)), 0});
+}
+
+bool save(Capture const& capture, char const* path) {
+  auto fill_count = len(capture.fills);
+  auto record_count = len(capture.records);
+  CaptureHeader header {CaptureHeader::magic, CaptureHeader::version, capture.width, capture.height};
+  header.fill_count = fill_count;
+  header.record_count = record_count;
+  header.fills = align(sizeof(header));
+  header.fill_types = align(header.fills + fill_count * sizeof(FillData));
+  header.records = align(header.fill_types + fill_count);
+  header.payload = align(header.records + record_count * sizeof(CaptureRecord));
+  header.size = header.payload + len(capture.payload);
+
+  auto file = fopen(path, "wb");
+  if (!file)
+    return false;
+  auto written = 0u;
+  auto write = [&](u32 offset, void const* data, u32 size) {
+    static constexpr char zeros[8] {};
+    fwrite(zeros, 1, offset - written, file);
+    fwrite(data, 1, size, file);
+    written = offset + size;
+  };
+  write(0, &header, sizeof(header));
+  write(header.fills, capture.fills.begin(), fill_count * sizeof(FillData));
+  write(header.fill_types, capture.fill_types.begin(), fill_count);
+  write(header.records, capture.records.begin(), record_count * sizeof(CaptureRecord));
+  write(header.payload, capture.payload.begin(), len(capture.payload));
+  auto ok = !ferror(file);
+  return fclose(file) == 0 && ok;
+}
+
+bool replay(Canvas& canvas, void const* data, size_t size) {
+  if (!valid(data, size))
+    return false;
+  auto const& header = *at<CaptureHeader>(data, 0);
+
+  auto fills = at<FillData>(data, header.fills);
+  auto fill_types = at<u8>(data, header.fill_types);
+  auto records = at<CaptureRecord>(data, header.records);
+  auto payload = static_cast<char const*>(data) + header.payload;
+
+  for (u32 k = 0; k < header.record_count; ++k) {
+    auto const& record = records[k];
+    switch (record.kind) {
+      case CaptureRecord::clear: {
+        auto color = *at<Pixel>(payload, record.offset);
+        auto const& clip = canvas.clip;
+        for (auto i = clip.y0; i < clip.y1; ++i)
+          for (auto j = clip.x0; j < clip.x1; ++j)
+            canvas.at(i, j) = color;
+        break;
+      }
+      case CaptureRecord::edges:
+        render_sorted(canvas, *at<AllEdges>(payload, record.offset));
+        break;
+      case CaptureRecord::spans: {
+        auto spans = at<CaptureSpan>(payload, record.offset);
+        for (u32 s = 0; s < record.count; ++s) {
+          auto const& span = spans[s];
+          setrow(canvas, span.row, span.begin, span.end, fill_types[span.fill], fills[span.fill]);
+        }
+        break;
+      }
+      case CaptureRecord::pixels: {
+        auto span = *at<CaptureSpan>(payload, record.offset);
+        auto pixels = at<Pixel>(payload, record.offset + sizeof(CaptureSpan));
+        auto j0 = span.begin;
+        auto j1 = span.end;
+        if (clip_span(canvas, span.row, j0, j1))
+          memcpy(&canvas.at(span.row, j0), &pixels[j0 - span.begin], (j1 - j0) * sizeof(Pixel));
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+bool map_capture(MappedCapture& mapped, char const* path) {
+  auto fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat info;
+  auto data = fstat(fd, &info) == 0 && info.st_size > 0
+    ? mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0)
+    : MAP_FAILED;
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+  mapped = {data, static_cast<size_t>(info.st_size)};
+  return true;
+}
+
+void unmap_capture(MappedCapture& mapped) {
+  if (mapped.data)
+    munmap(const_cast<void*>(mapped.data), mapped.size);
+  mapped = {};
+}
+
+}
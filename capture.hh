@@ -0,0 +1,86 @@
+#pragma once
+
+#include "canvas.hh"
+#include "edges.hh"
+#include "list.hh"
+
+#include <cstddef>
+
+namespace PW {
+
+// Scene captures. A capture is one flat block: a header, the fill table,
+// the record table and the payloads, all at 8-byte aligned offsets, so a
+// mapped file replays in place without parsing or copying.
+//
+// Edge lists are kept whole, already sorted, and spans keep an index into the
+// fill table. Fills that point at other memory (ramps, textures, layers,
+// masks) can't be stored by value, so those spans keep the pixels they
+// produced instead.
+
+struct CaptureHeader {
+  enum : u32 { magic = 0x43535750, version = 3 };  // "PWSC"
+  u32 magic_number;
+  u32 version_number;
+  u32 width;
+  u32 height;
+  u32 size;
+  u32 fill_count;
+  u32 record_count;
+  u32 fills;       // FillData[fill_count]
+  u32 fill_types;  // u8[fill_count]
+  u32 records;     // CaptureRecord[record_count]
+  u32 payload;
+  u32 reserved;
+};
+
+struct CaptureSpan {
+  int row;
+  int begin;
+  int end;
+  u32 fill;
+};
+
+// `offset` is from the start of the payload.
+struct CaptureRecord {
+  enum Kind : u32 {
+    clear,   // Pixel
+    edges,   // AllEdges
+    spans,   // CaptureSpan[count]
+    pixels,  // CaptureSpan, then Pixel[end - begin]
+  };
+  u32 kind;
+  u32 count;
+  u32 offset;
+  u32 reserved;
+};
+
+struct Capture {
+  u32 width {};
+  u32 height {};
+  List<FillData> fills;
+  List<u8> fill_types;
+  List<CaptureRecord> records;
+  List<u8> payload;
+};
+
+void begin(Capture& capture, Canvas const& canvas);
+void record_clear(Capture& capture, Pixel color);
+// Called by render, with the edges sorted. Returns false when the edges use
+// fills that have to be captured as pixels, span by span.
+bool record_edges(Capture& capture, AllEdges const& edges);
+void record_span(Capture& capture, Canvas const& canvas, u32 i, u32 j0, u32 j1, u8 fill_type, FillData const& fill);
+bool save(Capture const& capture, char const* path);
+
+// Replays a capture held in memory. Returns false, drawing nothing, if it is
+// not a well-formed capture of this version.
+bool replay(Canvas& canvas, void const* data, size_t size);
+
+struct MappedCapture {
+  void const* data {};
+  size_t size {};
+};
+
+bool map_capture(MappedCapture& mapped, char const* path);
+void unmap_capture(MappedCapture& mapped);
+
+}
@@ -0,0 +1,72 @@
+#include "canvas.hh"
+#include "fill.hh"
+#include "math.hh"
+
+#include <cmath>
+
+namespace PW {
+
+namespace {
+
+int to_pixel(float coord, int lo, int hi) {
+  auto grid = static_cast<int>(ceil(guard(coord) - .5f));
+  return grid < lo ? lo : grid > hi ? hi : grid;
+}
+
+float sqr(float value) {
+  return value * value;
+}
+
+}
+
+void circle(Canvas& canvas, Point center, float radius, Pixel color) {
+  auto cx = center.x;
+  auto cy = center.y;
+  auto outer_radius = radius + .5f;
+  auto lo = Point {cx - outer_radius, cy - outer_radius};
+  auto hi = Point {cx + outer_radius, cy + outer_radius};
+  if (culled(canvas, lo, hi))
+    return;
+  count_primitive(canvas);
+  auto const& clip = canvas.clip;
+  auto column = [&](float x) { return to_pixel(x, clip.x0, clip.x1); };
+  auto row = [&](float y) { return to_pixel(y, clip.y0, clip.y1); };
+  auto inner_radius = radius - .5f;
+  auto outer_radius_squared = sqr(outer_radius);
+  auto inner_radius_squared = sqr(inner_radius);
+
+  auto edge = RadialGradient {color, center, outer_radius, -1.f};
+  auto interior = Solid {color};
+
+  auto edgeRow = [&](int i) {
+    auto y2 = sqr(i + .5f - cy);
+    auto width = sqrt(outer_radius_squared - y2);
+    auto j1 = column(cx - width);
+    auto j2 = column(cx + width);
+    setrow(canvas, i, j1, j2, edge);
+  };
+
+  auto i1 = row(cy - outer_radius);
+  auto i2 = row(cy - inner_radius);
+  auto i3 = row(cy + inner_radius);
+  auto i4 = row(cy + outer_radius);
+
+  for (auto i = i1; i < i2; ++i)
+    edgeRow(i);
+  for (auto i = i2; i < i3; ++i) {
+    auto y2 = sqr(i + .5f - cy);
+    auto outer_width = sqrt(outer_radius_squared - y2);
+    auto inner_width = sqrt(inner_radius_squared - y2);
+    auto j1 = column(cx - outer_width);
+    auto j2 = column(cx - inner_width);
+    auto j3 = column(cx + inner_width);
+    auto j4 = column(cx + outer_width);
+    setrow(canvas, i, j1, j2, edge);
+    setrow(canvas, i, j2, j3, interior);
+    setrow(canvas, i, j3, j4, edge);
+  }
+  for (auto i = i3; i < i4; ++i)
+    edgeRow(i);
+}
+
+}
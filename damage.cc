@@ -0,0 +1,80 @@
+#include "damage.hh"
+
+#include <bit>
+#include <cstring>
+
+namespace PW {
+
+namespace {
+
+constexpr u32 size = Damage::size;
+
+// Two pixels per multiply; four lanes keep the multiplies independent.
+uint64_t hash_tile(Canvas const& canvas, u32 x0, u32 y0, u32 w, u32 h) {
+  constexpr uint64_t k = 0x9e3779b97f4a7c15;
+  uint64_t lanes[4] {1, 2, 3, 4};
+  for (auto i = y0; i < y0 + h; ++i) {
+    auto row = &canvas.data[i * canvas.stride + x0];
+    u32 j = 0;
+    for (; j + 8 <= w; j += 8) {
+      for (u32 l = 0; l < 4; ++l) {
+        uint64_t pair;
+        memcpy(&pair, &row[j + 2 * l], sizeof(pair));
+        lanes[l] = (lanes[l] ^ pair) * k;
+      }
+    }
+    for (; j < w; ++j)
+      lanes[0] = (lanes[0] ^ std::bit_cast<u32>(row[j])) * k;
+  }
+  return lanes[0] ^ std::rotl(lanes[1], 16) ^ std::rotl(lanes[2], 32) ^ std::rotl(lanes[3], 48);
+}
+
+// Returns whether the tile grid stayed the same.
+bool layout(Damage& damage, Canvas const& canvas) {
+  if (damage.width == canvas.width && damage.height == canvas.height)
+    return true;
+  damage.width = canvas.width;
+  damage.height = canvas.height;
+  damage.columns = (canvas.width + size - 1) / size;
+  damage.rows = (canvas.height + size - 1) / size;
+  damage.hashes.resize(damage.columns * damage.rows);
+  damage.changed.resize((damage.columns * damage.rows + 31) / 32);
+  return false;
+}
+
+}
+
+void update(Damage& damage, Canvas const& canvas) {
+  auto compare = layout(damage, canvas) && damage.valid;
+  damage.valid = true;
+  for (auto& word: damage.changed)
+    word = 0;
+  damage.changed_count = 0;
+
+  for (u32 row = 0; row < damage.rows; ++row) {
+    for (u32 column = 0; column < damage.columns; ++column) {
+      auto x0 = column * size;
+      auto y0 = row * size;
+      auto hash = hash_tile(canvas, x0, y0, min(size, canvas.width - x0), min(size, canvas.height - y0));
+      auto tile = row * damage.columns + column;
+      if (compare && damage.hashes[tile] == hash)
+        continue;
+      damage.hashes[tile] = hash;
+      damage.changed[tile / 32] |= 1u << tile % 32;
+      damage.changed_count += 1;
+    }
+  }
+}
+
+void skip(Damage& damage, Canvas const& canvas) {
+  layout(damage, canvas);
+  damage.valid = false;
+  for (auto& word: damage.changed)
+    word = 0;
+  auto count = damage.columns * damage.rows;
+  for (u32 tile = 0; tile < count; ++tile)
+    damage.changed[tile / 32] |= 1u << tile % 32;
+  damage.changed_count = count;
+}
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "canvas.hh"
+#include "list.hh"
+
+#include <cstdint>
+
+namespace PW {
+
+// The tiles of a frame that differ from the frame painted before it. Every
+// paint redraws the whole canvas, so tiles are compared by a hash of their
+// pixels rather than by which ones were written.
+struct Damage {
+  enum { size = 32 };
+
+  u32 width {};
+  u32 height {};
+  u32 columns {};
+  u32 rows {};
+  bool valid {};
+  List<uint64_t> hashes;
+  // One bit per tile, row by row, 32 tiles to a word.
+  List<u32> changed;
+  u32 changed_count {};
+};
+
+// Compares the canvas with the last frame passed here. The first frame, and
+// the first after a resize or a skipped frame, changes every tile.
+void update(Damage& damage, Canvas const& canvas);
+// Marks every tile changed, for frames that aren't compared.
+void skip(Damage& damage, Canvas const& canvas);
+
+}
@@ -0,0 +1,273 @@
+#include "draw-list.hh"
+#include "fill.hh"
+
+#include <cstring>
+
+namespace PW {
+
+namespace {
+
+bool overlap(Rect const& a, Rect const& b) {
+  return a.x0 < b.x1 && b.x0 < a.x1 && a.y0 < b.y1 && b.y0 < a.y1;
+}
+
+u32 push_fill(DrawList& list, u8 fill_type, FillData const& fill) {
+  auto count = len(list.fill_data);
+  if (count && list.fill_type[count - 1] == fill_type &&
+      !memcmp(&list.fill_data[count - 1], &fill, sizeof(FillData)))
+    return count - 1;
+  list.fill_data.push(fill);
+  list.fill_type.push(fill_type);
+  return count;
+}
+
+// Drops the current item if it has no spans.
+void close(DrawList& list) {
+  if (!list.open)
+    return;
+  list.open = false;
+  auto count = len(list.items);
+  auto& item = list.items[count - 1];
+  item.last = len(list.spans);
+  if (item.first == item.last)
+    list.items.resize(count - 1);
+}
+
+// Two passes over the pairs of items: one counts the edges out of each item,
+// the other fills them in. Every pair is compared, so linking grows with the
+// square of the number of items.
+void link(DrawList& list) {
+  auto count = len(list.items);
+  list.pending.resize(count);
+  for (u32 b = 0; b < count; ++b) {
+    list.pending[b] = 0;
+    list.items[b].dependent_count = 0;
+  }
+  for (u32 b = 0; b < count; ++b) {
+    for (u32 a = 0; a < b; ++a) {
+      if (overlap(list.items[a].bounds, list.items[b].bounds)) {
+        list.items[a].dependent_count += 1;
+        list.pending[b] += 1;
+      }
+    }
+  }
+
+  u32 total = 0;
+  for (auto& item: list.items) {
+    item.dependents = total;
+    total += std::exchange(item.dependent_count, 0);
+  }
+  list.edges.resize(total);
+  for (u32 b = 0; b < count; ++b) {
+    for (u32 a = 0; a < b; ++a) {
+      auto& item = list.items[a];
+      if (overlap(item.bounds, list.items[b].bounds))
+        list.edges[item.dependents + item.dependent_count++] = b;
+    }
+  }
+}
+
+void run(DrawList const& list, Canvas& canvas, u32 index) {
+  auto const& item = list.items[index];
+  for (auto k = item.first; k < item.last; ++k) {
+    auto const& s = list.spans[k];
+    auto out = &canvas.at(s.row, s.begin);
+    auto n = static_cast<u32>(s.end - s.begin);
+    auto p = Point {s.begin + .5f, s.row + .5f};
+    if (canvas.gamma_correct)
+      span<Linear>(out, n, p, list.fill_type[s.fill], list.fill_data[s.fill]);
+    else
+      span(out, n, p, list.fill_type[s.fill], list.fill_data[s.fill]);
+  }
+}
+
+// Wakes parked threads. The counters they wait on are changed before this
+// and checked again under the lock, so no wakeup is lost.
+void notify(Workers& workers, bool all) {
+  if (!workers.sleepers.load())
+    return;
+  { std::lock_guard lock {workers.mutex}; }
+  if (all)
+    workers.idle.notify_all();
+  else
+    workers.idle.notify_one();
+}
+
+void push_ready(Workers& workers, u32 worker, u32 item) {
+  {
+    auto& queue = workers.queues[worker];
+    std::lock_guard lock {queue.mutex};
+    queue.items.push(item);
+  }
+  workers.queued.fetch_add(1);
+  notify(workers, false);
+}
+
+void park(Workers& workers) {
+  std::unique_lock lock {workers.mutex};
+  workers.sleepers.fetch_add(1);
+  workers.idle.wait(lock, [&] { return workers.queued.load() || !workers.remaining.load(); });
+  workers.sleepers.fetch_sub(1);
+}
+
+bool take(Workers::Queue& queue, u32& item, bool own) {
+  std::lock_guard lock {queue.mutex};
+  auto count = len(queue.items);
+  if (queue.front == count)
+    return false;
+  if (own) {
+    item = queue.items[count - 1];
+    queue.items.resize(count - 1);
+  } else {
+    item = queue.items[queue.front++];
+  }
+  if (queue.front == len(queue.items)) {
+    queue.items.clear();
+    queue.front = 0;
+  }
+  return true;
+}
+
+bool take(Workers& workers, u32 worker, u32& item) {
+  if (take(workers.queues[worker], item, true))
+    return true;
+  for (u32 k = 1; k < workers.thread_count; ++k)
+    if (take(workers.queues[(worker + k) % workers.thread_count], item, false))
+      return true;
+  return false;
+}
+
+// Runs items until all of them are done. Finishing an item releases its
+// dependents; the last dependency to finish queues the item on its own queue.
+void work(Workers& workers, u32 worker) {
+  auto& list = *workers.list;
+  auto& canvas = *workers.canvas;
+  while (workers.remaining.load(std::memory_order_acquire)) {
+    u32 index;
+    if (!take(workers, worker, index)) {
+      park(workers);
+      continue;
+    }
+    workers.queued.fetch_sub(1);
+    run(list, canvas, index);
+    auto const& item = list.items[index];
+    for (auto k = item.dependents; k < item.dependents + item.dependent_count; ++k) {
+      auto dependent = list.edges[k];
+      if (std::atomic_ref<u32> {list.pending[dependent]}.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        push_ready(workers, worker, dependent);
+    }
+    if (workers.remaining.fetch_sub(1) == 1)
+      notify(workers, true);
+  }
+}
+
+void thread_main(Workers& workers, u32 worker) {
+  u32 seen = 0;
+  for (;;) {
+    {
+      std::unique_lock lock {workers.mutex};
+      workers.wake.wait(lock, [&] { return workers.stopping || workers.generation != seen; });
+      if (workers.stopping)
+        return;
+      seen = workers.generation;
+    }
+    work(workers, worker);
+    {
+      std::lock_guard lock {workers.mutex};
+      workers.busy.fetch_sub(1, std::memory_order_release);
+    }
+    workers.idle.notify_all();
+  }
+}
+
+void stop(Workers& workers) {
+  {
+    std::lock_guard lock {workers.mutex};
+    workers.stopping = true;
+  }
+  workers.wake.notify_all();
+  for (u32 k = 1; k < workers.thread_count; ++k)
+    workers.threads[k].join();
+  workers.stopping = false;
+  workers.thread_count = 1;
+}
+
+}
+
+Workers::~Workers() {
+  stop(*this);
+}
+
+void start(Workers& workers, u32 threads) {
+  stop(workers);
+  workers.thread_count = max(1u, min<u32>(threads, Workers::max_threads));
+  for (u32 k = 1; k < workers.thread_count; ++k)
+    workers.threads[k] = std::thread {thread_main, std::ref(workers), k};
+}
+
+void begin(DrawList& list) {
+  list.spans.clear();
+  list.fill_data.clear();
+  list.fill_type.clear();
+  list.items.clear();
+  list.open = false;
+}
+
+void next_item(DrawList& list) {
+  close(list);
+  list.items.push({{}, len(list.spans), 0, 0, 0});
+  list.open = true;
+}
+
+void record(DrawList& list, u32 i, u32 j0, u32 j1, u8 fill_type, FillData const& fill) {
+  if (!list.open)
+    next_item(list);
+  auto& item = list.items[len(list.items) - 1];
+  auto row = static_cast<int>(i);
+  auto begin = static_cast<int>(j0);
+  auto end = static_cast<int>(j1);
+  auto& bounds = item.bounds;
+  if (item.first == len(list.spans))
+    bounds = {begin, row, end, row + 1};
+  else
+    bounds = {min(bounds.x0, begin), min(bounds.y0, row), max(bounds.x1, end), max(bounds.y1, row + 1)};
+  list.spans.push({row, begin, end, push_fill(list, fill_type, fill)});
+}
+
+// The painting thread is worker 0. The other workers are woken for the list
+// and counted in `busy`, so the list isn't touched again until they are all
+// done with it.
+void execute(DrawList& list, Canvas& canvas, Workers& workers) {
+  close(list);
+  auto count = len(list.items);
+  if (!count)
+    return;
+  link(list);
+
+  for (u32 k = 0; k < workers.thread_count; ++k) {
+    workers.queues[k].items.clear();
+    workers.queues[k].front = 0;
+  }
+  u32 next = 0;
+  for (u32 k = 0; k < count; ++k)
+    if (!list.pending[k])
+      workers.queues[next++ % workers.thread_count].items.push(k);
+  workers.queued.store(next);
+
+  workers.list = &list;
+  workers.canvas = &canvas;
+  workers.remaining.store(count, std::memory_order_relaxed);
+  if (workers.thread_count > 1) {
+    {
+      std::lock_guard lock {workers.mutex};
+      workers.busy.store(workers.thread_count - 1, std::memory_order_relaxed);
+      workers.generation += 1;
+    }
+    workers.wake.notify_all();
+  }
+  work(workers, 0);
+  std::unique_lock lock {workers.mutex};
+  workers.idle.wait(lock, [&] { return !workers.busy.load(std::memory_order_acquire); });
+}
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "canvas.hh"
+#include "edges.hh"
+#include "list.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace PW {
+
+// Parallel mode. Spans are recorded instead of written, grouped into one item
+// per primitive. An item depends on every earlier item whose bounds overlap
+// its own, and items run on the workers as soon as their dependencies are
+// done, so overlapping primitives keep painter's order.
+//
+// Like tiled mode, spans keep pointers to ramps, layers and masks, which have
+// to stay alive until the list is executed.
+struct DrawList {
+  struct Span {
+    int row;
+    int begin;
+    int end;
+    u32 fill;
+  };
+
+  // Spans [first, last), within `bounds`. `dependents` indexes `edges`.
+  struct Item {
+    Rect bounds;
+    u32 first;
+    u32 last;
+    u32 dependents;
+    u32 dependent_count;
+  };
+
+  List<Span> spans;
+  List<FillData> fill_data;
+  List<u8> fill_type;
+  List<Item> items;
+  List<u32> edges;
+  // Dependencies not yet done, per item; updated atomically while executing.
+  List<u32> pending;
+  bool open {};
+};
+
+// A pool of threads that execute draw lists. The painting thread works too,
+// so `threads` counts it.
+struct Workers {
+  enum { max_threads = 16 };
+
+  // Ready items. The owner takes from the back, thieves from the front.
+  struct Queue {
+    std::mutex mutex;
+    List<u32> items;
+    u32 front {};
+  };
+
+  Workers() = default;
+  Workers(Workers const&) = delete;
+  ~Workers();
+
+  std::thread threads[max_threads];
+  Queue queues[max_threads];
+  u32 thread_count {1};
+  std::mutex mutex;
+  std::condition_variable wake;
+  u32 generation {};
+  bool stopping {};
+  DrawList* list {};
+  Canvas* canvas {};
+  std::atomic<u32> remaining {};
+  std::atomic<u32> busy {};
+  // Threads without work park on `idle` until an item is queued or the list
+  // is done; `queued` counts items in the queues, and `sleepers` the parked
+  // threads, so that queueing only takes the lock when someone is waiting.
+  std::condition_variable idle;
+  std::atomic<u32> queued {};
+  std::atomic<u32> sleepers {};
+};
+
+void begin(DrawList& list);
+// Starts the item of a new primitive.
+void next_item(DrawList& list);
+void record(DrawList& list, u32 i, u32 j0, u32 j1, u8 fill_type, FillData const& fill);
+void execute(DrawList& list, Canvas& canvas, Workers& workers);
+
+void start(Workers& workers, u32 threads);
+
+}
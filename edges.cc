@@ -1,8 +1,12 @@
 #include "edges.hh"
+#include "capture.hh"
+#include "fill.hh"
+#include "fixed.hh"
 #include "math.hh"
 
 #include <cmath>
 #include <algorithm>
+#include <bit>
 
 namespace PW {
 
@@ -12,11 +16,6 @@ static bool operator<(EdgeLimit const& lhs, EdgeLimit const& rhs) {
 
 namespace {
 
-void check(bool condition) {
-  if (!condition)
-    abort();
-}
-
 auto sqr(float value) -> float { return value * value; }
 
 float eval(LeftArc const& e, float y) {
@@ -44,42 +43,35 @@ float eval_edge(u8 type, EdgeData const& data, float y) {
   return evals[type](data, y);
 }
 
-int to_pixel(float coord) {
-  return static_cast<int>(coord + .5f);
-}
-
-// dedup
-Pixel lerp(Pixel const& a, Pixel const& b, float t) {
-  Pixel c;
-  for (auto i = 0u; i < 4u; ++i)
-    c[i] = a[i] + (b[i] - a[i]) * t;
-  return c;
+// Evaluates an edge on the centers of `band_rows` rows from `y`. The rows
+// past the end of the edge produce values that are never used.
+template <class T>
+void eval_band(EdgeData const& data, float y, float* x) {
+  // A copy, so the stores to `x` can't alias it and the loop vectorizes.
+  auto const edge = reinterpret_cast<T const&>(data);
+  for (auto r = 0; r < band_rows; ++r)
+    x[r] = eval(edge, y + r);
 }
 
-void setrow(Canvas& canvas, u32 i, u32 j0, u32 j1, RadialGradient const& radial) {
-  for (u32 j = j0; j < j1; ++j) {
-    auto p = Point {j + .5f, i + .5f};
-    auto t = max(0.f, min(1.f, (len(p - radial.position) - radial.start_radius) / radial.thickness));
-    auto& curr = canvas.data[i * canvas.stride + j];
-    curr = lerp(curr, radial.color, t);
+void eval_edge_band(u8 type, EdgeData const& data, float y, float* x) {
+  switch (type) {
+    case Line::edge_type:
+      return eval_band<Line>(data, y, x);
+    case LeftArc::edge_type:
+      return eval_band<LeftArc>(data, y, x);
+    case RightArc::edge_type:
+      return eval_band<RightArc>(data, y, x);
   }
 }
 
-void setrow(Canvas& canvas, u32 i, u32 j1, u32 j2, Solid const& solid) {
-  for (u32 j = j1; j < j2; ++j)
-    canvas.data[i * canvas.stride + j] = solid.color;
-}
-
-void setrow(Canvas& canvas, u32 i, u32 j0, u32 j1, LinearGradient const& gradient) {
-  for (u32 j = j0; j < j1; ++j) {
-    auto p = Point {j + .5f, i + .5f};
-    auto t = max(0.f, min(1.f, dot(p - gradient.position, gradient.direction)));
-    auto& curr = canvas.data[i * canvas.stride + j];
-    curr = lerp(gradient.color, curr, t);
-  }
+int to_pixel(float coord) {
+  return static_cast<int>(floor(guard(coord) + .5f));
 }
 
 struct Edges {
+  // A path can cross a row with every one of its edges.
+  enum { max_active = AllEdges::max_edges };
+
   AllEdges const& edge_info;
   u8 edges[AllEdges::max_edges];
   u32 active[AllEdges::max_edges] {};
@@ -106,60 +98,138 @@ struct Edges {
   struct Checkpoint {
     float x;
     u32 fill;
+    signed char winding;
     bool operator<(Checkpoint const& rhs) const { return x < rhs.x; }
   };
 
-  void blit(Canvas& canvas, u32 i0, u32 i1) {
-    for (auto i = i0; i < i1; ++i) {
-      auto y = i + .5f;
-
-      Checkpoint js[8];
-      for (auto k = 0; k < edge_count; ++k) {
-        auto e = edges[k];
-        js[k] = {
-          eval_edge(edge_info.type[e], edge_info.edge_data[e], y),
-          edge_info.fill[e]};
-      }
-      std::sort(&js[0], &js[edge_count]);
+  void setspan(Canvas& canvas, int i, int j0, int j1, u32 fill) {
+    setrow(canvas, i, j0, j1, edge_info.fill_type[fill - 1], edge_info.fill_data[fill - 1]);
+  }
 
-      auto cur_j = to_pixel(js[0].x);
+  // Walks one row's crossings, sorted by x. Region edges set the fill to
+  // their right; winding edges add to their fill's count, and the fill covers
+  // the span when its rule says the count is inside. Region fills are drawn
+  // first, then covered winding fills in order.
+  void walk(Canvas& canvas, int i, auto const* js, auto column) {
+    if (!edge_info.winding_count) {
+      auto cur_j = column(js[0].x);
       auto cur_fill = js[0].fill;
       for (auto k = 1; k < edge_count; ++k) {
         auto const& next = js[k];
-        auto next_j = to_pixel(next.x);
-        if (next_j > cur_j && cur_fill) {
-          switch (edge_info.fill_type[cur_fill - 1]) {
-            case 0:
-              setrow(canvas, i, cur_j, next_j, reinterpret_cast<RadialGradient const&>(edge_info.fill_data[cur_fill - 1]));
-              break;
-            case 1:
-              setrow(canvas, i, cur_j, next_j, reinterpret_cast<Solid const&>(edge_info.fill_data[cur_fill - 1]));
-              break;
-            case 2:
-              setrow(canvas, i, cur_j, next_j, reinterpret_cast<LinearGradient const&>(edge_info.fill_data[cur_fill - 1]));
-              break;
-          }
-        }
+        auto next_j = column(next.x);
+        if (next_j > cur_j && cur_fill)
+          setspan(canvas, i, cur_j, next_j, cur_fill);
         cur_j = next_j;
         cur_fill = next.fill;
       }
+      return;
+    }
+
+    int winding[AllEdges::max_fills] {};
+    u32 inside = 0;
+    u32 region = 0;
+    auto cur_j = column(js[0].x);
+    for (auto k = 0; k < edge_count; ++k) {
+      auto const& next = js[k];
+      auto next_j = column(next.x);
+      if (next_j > cur_j) {
+        if (region)
+          setspan(canvas, i, cur_j, next_j, region);
+        for (auto fills = inside; fills; fills &= fills - 1)
+          setspan(canvas, i, cur_j, next_j, std::countr_zero(fills) + 1);
+        cur_j = next_j;
+      }
+      if (!next.winding) {
+        region = next.fill;
+        continue;
+      }
+      auto f = next.fill - 1;
+      winding[f] += next.winding;
+      auto covered = edge_info.fill_rule[f] == FillRule::even_odd ? winding[f] & 1 : winding[f] != 0;
+      inside = covered ? inside | 1u << f : inside & ~(1u << f);
     }
   }
+
+  // Lines step in fixed point; arcs are still evaluated in float, then
+  // converted, so that all crossings sort and round the same way.
+  void blit_fixed(Canvas& canvas, int i0, int i1) {
+    auto i = clip_row(canvas, i0);
+    auto end = clip_row(canvas, i1);
+    if (i >= end)
+      return;
+
+    FixedLine lines[max_active] {};
+    for (auto k = 0; k < edge_count; ++k) {
+      auto e = edges[k];
+      if (edge_info.type[e] != Line::edge_type)
+        continue;
+      auto const& line = reinterpret_cast<Line const&>(edge_info.edge_data[e]);
+      lines[k] = fixed_line(to_fixed(line.start.x), to_fixed(line.start.y), to_fixed_slope(line.slope), i);
+    }
+
+    struct Crossing {
+      int64_t x;
+      u32 fill;
+      signed char winding;
+      bool operator<(Crossing const& rhs) const { return x < rhs.x; }
+    };
+    for (; i < end; ++i) {
+      auto y = i + .5f;
+      Crossing js[max_active];
+      for (auto k = 0; k < edge_count; ++k) {
+        auto e = edges[k];
+        auto type = edge_info.type[e];
+        auto x = type == Line::edge_type
+          ? lines[k].x
+          : int64_t(to_fixed(eval_edge(type, edge_info.edge_data[e], y))) << 16;
+        js[k] = {x, edge_info.fill[e], edge_info.winding[e]};
+        lines[k].next();
+      }
+      std::sort(&js[0], &js[edge_count]);
+      walk(canvas, i, js, [](int64_t x) { return FixedLine {x, 0}.column(); });
+    }
+  }
+
+  void blit(Canvas& canvas, int i0, int i1) {
+    if (canvas.fixed_point)
+      return blit_fixed(canvas, i0, i1);
+    for (auto band = clip_row(canvas, i0), end = clip_row(canvas, i1); band < end; band += band_rows) {
+      // One row of x per active edge, for the whole band.
+      float xs[max_active][band_rows];
+      for (auto k = 0; k < edge_count; ++k) {
+        auto e = edges[k];
+        eval_edge_band(edge_info.type[e], edge_info.edge_data[e], band + .5f, xs[k]);
+      }
+      for (auto i = band, rows_end = min(band + band_rows, end); i < rows_end; ++i)
+        blit_row(canvas, i, xs, i - band);
+    }
+  }
+
+  void blit_row(Canvas& canvas, int i, float const (*xs)[band_rows], int r) {
+    Checkpoint js[max_active];
+    for (auto k = 0; k < edge_count; ++k) {
+      auto e = edges[k];
+      js[k] = {xs[k][r], edge_info.fill[e], edge_info.winding[e]};
+    }
+    std::sort(&js[0], &js[edge_count]);
+    walk(canvas, i, js, [](float x) { return to_pixel(x); });
+  }
 };
 
 }  // namespace
 
-u32 push_fill(AllEdges& edges, u8 fill_type, FillData const& fill) {
+u32 push_fill(AllEdges& edges, u8 fill_type, FillData const& fill, FillRule rule) {
   check(edges.fill_count < AllEdges::max_fills);
   auto index = edges.fill_count++;
   edges.fill_data[index] = fill;
   edges.fill_type[index] = fill_type;
+  edges.fill_rule[index] = rule;
   return index + 1;
 }
 
-void push_edge(AllEdges& edges, float y0, float y1, u32 fill_right, EdgeData const& edge, u8 edge_type) {
-  auto i0 = static_cast<u32>(y0 + .5f);
-  auto i1 = static_cast<u32>(y1 + .5f);
+void push_edge(AllEdges& edges, float y0, float y1, u32 fill_right, EdgeData const& edge, u8 edge_type, signed char winding) {
+  auto i0 = to_pixel(y0);
+  auto i1 = to_pixel(y1);
   if (i0 == i1)
     return;
   check(edges.count < AllEdges::max_edges);
@@ -167,17 +237,34 @@ void push_edge(AllEdges& edges, float y0, float y1, u32 fill_right, EdgeData con
   edges.edge_data[index] = edge;
   edges.type[index] = edge_type;
   edges.fill[index] = fill_right;
+  edges.winding[index] = winding;
+  edges.winding_count += winding != 0;
   edges.lim[2 * index] = {index, i0};
   edges.lim[2 * index + 1] = {index, i1};
 }
 
 void render(Canvas& canvas, AllEdges& edges) {
+  if (!edges.count)
+    return;
+  std::sort(&edges.lim[0], &edges.lim[2 * edges.count]);
+
+  // A captured edge list replays whole, so its spans aren't captured again.
+  auto capture = canvas.capture;
+  if (capture && record_edges(*capture, edges))
+    canvas.capture = nullptr;
+  render_sorted(canvas, edges);
+  canvas.capture = capture;
+}
+
+void render_sorted(Canvas& canvas, AllEdges const& edges) {
   if (!edges.count)
     return;
 
   auto begin = &edges.lim[0];
   auto end = &edges.lim[2 * edges.count];
-  std::sort(begin, end);
+  if (begin->i >= canvas.clip.y1 || end[-1].i <= canvas.clip.y0)
+    return;
+  count_primitive(canvas, edges.count);
 
   Edges renderer {edges};
   renderer.update(begin[0].edge);
@@ -24,47 +24,60 @@ struct RightArc {
 
 struct EdgeLimit {
   u32 edge;
-  u32 i;
+  int i;
 };
 
-struct FillData {
-  float words[5];
+struct alignas(8) FillData {
+  float words[10];
 };
 
 struct EdgeData {
   float words[3];
 };
 
+// Which pixels a fill covers, from the winding count of its edges.
+enum class FillRule : u8 { non_zero, even_odd };
+
+// An edge either bounds a region, setting the fill to its right, or belongs
+// to a path and adds its `winding` (+1 going down, -1 going up) to its fill's
+// count, which the fill's rule turns into coverage.
 struct AllEdges {
   enum { max_fills = 16, max_edges = 128 };
   FillData fill_data[max_fills];
   u8 fill_type[max_fills];
+  FillRule fill_rule[max_fills];
   u32 fill_count {};
   EdgeData edge_data[max_edges];
   u8 type[max_edges];
   u32 fill[max_edges];
+  signed char winding[max_edges];
   u32 count {};
+  u32 winding_count {};
   EdgeLimit lim[2 * max_edges];
 };
 
-u32 push_fill(AllEdges& edges, u8 fill_type, FillData const& fill);
+u32 push_fill(AllEdges& edges, u8 fill_type, FillData const& fill, FillRule rule = FillRule::non_zero);
 
 template <class T>
-u32 push_fill(AllEdges& edges, T const& fill) {
+u32 push_fill(AllEdges& edges, T const& fill, FillRule rule = FillRule::non_zero) {
   static_assert(sizeof(T) <= sizeof(FillData));
   static_assert(alignof(T) <= alignof(FillData));
-  return push_fill(edges, T::fill_type, reinterpret_cast<FillData const&>(fill));
+  FillData data;
+  reinterpret_cast<T&>(data) = fill;
+  return push_fill(edges, T::fill_type, data, rule);
 }
 
-void push_edge(AllEdges& edges, float y0, float y1, u32 fill_right, EdgeData const& edge, u8 edge_type);
+void push_edge(AllEdges& edges, float y0, float y1, u32 fill_right, EdgeData const& edge, u8 edge_type, signed char winding = 0);
 
 template <class T>
-void push_edge(AllEdges& edges, float y0, float y1, u32 fill_right, T const& edge) {
+void push_edge(AllEdges& edges, float y0, float y1, u32 fill_right, T const& edge, signed char winding = 0) {
   static_assert(sizeof(T) <= sizeof(EdgeData));
   static_assert(alignof(T) <= alignof(EdgeData));
-  return push_edge(edges, y0, y1, fill_right, reinterpret_cast<EdgeData const&>(edge), T::edge_type);
+  return push_edge(edges, y0, y1, fill_right, reinterpret_cast<EdgeData const&>(edge), T::edge_type, winding);
 }
 
 void render(Canvas& canvas, AllEdges& edges);
+// Renders edges whose limits are already sorted, as render leaves them.
+void render_sorted(Canvas& canvas, AllEdges const& edges);
 
 }
\ No newline at end of file
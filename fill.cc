@@ -0,0 +1,184 @@
+#include "fill.hh"
+#include "capture.hh"
+#include "draw-list.hh"
+#include "tiles.hh"
+
+#include <cmath>
+#include <cstdlib>
+
+namespace PW {
+
+namespace {
+
+auto make_srgb_tables() -> SrgbTables {
+  SrgbTables tables;
+  for (u32 k = 0; k < 256; ++k) {
+    auto c = k / 255.f;
+    auto l = c <= .04045f ? c / 12.92f : std::pow((c + .055f) / 1.055f, 2.4f);
+    tables.to_linear[k] = static_cast<u16>(l * 4095.f + .5f);
+  }
+  for (u32 k = 0; k < 4096; ++k) {
+    auto l = k / 4095.f;
+    auto c = l <= .0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.f / 2.4f) - .055f;
+    tables.to_srgb[k] = static_cast<u8>(c * 255.f + .5f);
+  }
+  return tables;
+}
+
+bool opaque(u8 fill_type, FillData const& fill) {
+  return fill_type == Solid::fill_type && fill_cast<Solid>(fill).color.alpha == 255;
+}
+
+void count(Stats& stats, u32 i, u32 j0, u32 j1, u8 fill_type) {
+  stats.spans += 1;
+  stats.pixels[fill_type] += j1 - j0;
+  if (auto hits = stats.hits) {
+    hits += i * stats.stride;
+    for (auto j = j0; j < j1; ++j) {
+      if (hits[j] == 1)
+        stats.overdrawn += 1;
+      if (hits[j] < 255)
+        hits[j] += 1;
+    }
+  }
+}
+
+void write(Canvas& canvas, u32 i, u32 j0, u32 j1, u8 fill_type, FillData const& fill) {
+  if (canvas.stats)
+    count(*canvas.stats, i, j0, j1, fill_type);
+  if (canvas.gamma_correct)
+    return span<Linear>(&canvas.at(i, j0), j1 - j0, {j0 + .5f, i + .5f}, fill_type, fill);
+  span(&canvas.at(i, j0), j1 - j0, {j0 + .5f, i + .5f}, fill_type, fill);
+}
+
+void occluded_setrow(Canvas& canvas, u32 i, u32 j0, u32 j1, u8 fill_type, FillData const& fill) {
+  auto& occlusion = *canvas.occlusion;
+  auto owner = &occlusion.owner[i * occlusion.stride];
+  auto layer = occlusion.layer;
+
+  if (!opaque(fill_type, fill)) {
+    if (occlusion.opaque_pass)
+      return;
+    for (auto j = j0; j < j1;) {
+      while (j < j1 && owner[j] >= layer)
+        ++j;
+      auto start = j;
+      while (j < j1 && owner[j] < layer)
+        ++j;
+      if (start < j)
+        write(canvas, i, start, j, fill_type, fill);
+    }
+    return;
+  }
+
+  // Steps run back to front, but primitives within a step run in order, so a
+  // later primitive of the same step takes over the pixels of an earlier one.
+  if (!occlusion.opaque_pass)
+    return;
+  auto& row = occlusion.rows[i];
+  row.begin = min(row.begin, j0);
+  row.end = max(row.end, j1);
+  for (auto j = j0; j < j1;) {
+    while (j < j1 && owner[j] > layer)
+      ++j;
+    auto start = j;
+    while (j < j1 && owner[j] <= layer)
+      owner[j++] = layer;
+    if (start < j)
+      write(canvas, i, start, j, fill_type, fill);
+  }
+}
+
+}
+
+SrgbTables const srgb_tables = make_srgb_tables();
+
+void hooked_setrow(Canvas& canvas, u32 i, u32 j0, u32 j1, u8 fill_type, FillData const& fill) {
+  if (auto capture = canvas.capture) {
+    // Drawn first, so that spans captured as pixels can read their result.
+    canvas.capture = nullptr;
+    setrow(canvas, i, j0, j1, fill_type, fill);
+    canvas.capture = capture;
+    return record_span(*capture, canvas, i, j0, j1, fill_type, fill);
+  }
+  if (canvas.tiles) {
+    if (canvas.stats)
+      count(*canvas.stats, i, j0, j1, fill_type);
+    return bin(*canvas.tiles, i, j0, j1, fill_type, fill);
+  }
+  if (canvas.draw_list) {
+    if (canvas.stats)
+      count(*canvas.stats, i, j0, j1, fill_type);
+    return record(*canvas.draw_list, i, j0, j1, fill_type, fill);
+  }
+  if (canvas.occlusion)
+    return occluded_setrow(canvas, i, j0, j1, fill_type, fill);
+  write(canvas, i, j0, j1, fill_type, fill);
+}
+
+void push_clip(Canvas& canvas, Rect rect) {
+  auto& clips = canvas.clips;
+  if (clips.depth == ClipStack::max_depth)
+    abort();
+  clips.saved[clips.depth++] = canvas.clip;
+  auto& clip = canvas.clip;
+  clip = {max(clip.x0, rect.x0), max(clip.y0, rect.y0), min(clip.x1, rect.x1), min(clip.y1, rect.y1)};
+  clip.x1 = max(clip.x0, clip.x1);
+  clip.y1 = max(clip.y0, clip.y1);
+}
+
+void pop_clip(Canvas& canvas) {
+  auto& clips = canvas.clips;
+  if (!clips.depth)
+    abort();
+  canvas.clip = clips.saved[--clips.depth];
+}
+
+void reset(Occlusion& occlusion, u32 height) {
+  for (u32 i = 0; i < height; ++i) {
+    auto& row = occlusion.rows[i];
+    auto owner = &occlusion.owner[i * occlusion.stride];
+    for (auto j = row.begin; j < row.end; ++j)
+      owner[j] = 0;
+    row = {~0u, 0};
+  }
+}
+
+void fill_background(Canvas& canvas, Pixel color) {
+  auto& occlusion = *canvas.occlusion;
+  for (u32 i = 0; i < canvas.height; ++i) {
+    auto out = &canvas.data[i * canvas.stride];
+    auto owner = &occlusion.owner[i * occlusion.stride];
+    auto row = occlusion.rows[i];
+    auto begin = min(row.begin, canvas.width);
+    auto end = max(begin, min(row.end, canvas.width));
+    for (u32 j = 0; j < begin; ++j)
+      out[j] = color;
+    for (auto j = begin; j < end; ++j)
+      if (!owner[j])
+        out[j] = color;
+    for (auto j = end; j < canvas.width; ++j)
+      out[j] = color;
+  }
+}
+
+void draw_heatmap(Canvas& canvas, Stats const& stats) {
+  constexpr Pixel heat[] {
+    {255, 0, 0, 0},
+    {255, 40, 40, 200},
+    {255, 40, 180, 60},
+    {255, 230, 210, 30},
+    {255, 240, 120, 20},
+    {255, 220, 20, 20},
+    {255, 255, 255, 255},
+  };
+  constexpr u32 hottest = sizeof(heat) / sizeof(*heat) - 1;
+  for (u32 i = 0; i < canvas.height; ++i) {
+    auto out = &canvas.data[i * canvas.stride];
+    auto hits = &stats.hits[i * stats.stride];
+    for (u32 j = 0; j < canvas.width; ++j)
+      out[j] = heat[min<u32>(hits[j], hottest)];
+  }
+}
+
+}
@@ -0,0 +1,395 @@
+#pragma once
+
+#include "canvas.hh"
+#include "edges.hh"
+#include "math.hh"
+
+namespace PW {
+
+inline auto lerp(Pixel const& a, Pixel const& b, float t) -> Pixel {
+  Pixel c;
+  for (auto i = 0u; i < 4u; ++i)
+    c[i] = a[i] + (b[i] - a[i]) * t;
+  return c;
+}
+
+// Source-over with the source's own alpha.
+inline void blend(Pixel& dst, Pixel src) {
+  int a = src.alpha + (src.alpha >> 7);
+  dst.alpha += ((255 - dst.alpha) * a) >> 8;
+  for (auto i = 1u; i < 4u; ++i)
+    dst[i] += ((src[i] - dst[i]) * a) >> 8;
+}
+
+// Premultiplied source-over with the source scaled by `opacity` out of 256.
+// Two channels share each multiply; lanes that carry past 255 saturate.
+inline void over(Pixel& dst, Pixel src, u32 opacity) {
+  auto s = std::bit_cast<u32>(src);
+  auto d = std::bit_cast<u32>(dst);
+  auto alpha = src.alpha * opacity >> 8;
+  auto keep = 256 - alpha - (alpha >> 7);
+  auto rb = ((s & 0xff00ff) * opacity >> 8 & 0xff00ff) + ((d & 0xff00ff) * keep >> 8 & 0xff00ff);
+  auto ag = ((s >> 8 & 0xff00ff) * opacity >> 8 & 0xff00ff) + ((d >> 8 & 0xff00ff) * keep >> 8 & 0xff00ff);
+  rb |= (rb >> 8 & 0x10001) * 0xff;
+  ag |= (ag >> 8 & 0x10001) * 0xff;
+  dst = std::bit_cast<Pixel>((rb & 0xff00ff) | (ag & 0xff00ff) << 8);
+}
+
+// sRGB bytes to 12-bit linear light and back, see fill.cc.
+struct SrgbTables {
+  u16 to_linear[256];
+  u8 to_srgb[4096];
+};
+
+extern SrgbTables const srgb_tables;
+
+// The span kernels mix colors through one of these. `Srgb` works on the
+// stored bytes; `Linear` mixes the color channels in linear light. Alpha is
+// mixed the same way by both.
+struct Srgb {
+  // Color channels in the units they are mixed in, from 0 to `channel_max`,
+  // for kernels that interpolate them themselves.
+  static constexpr float channel_max = 255.f;
+  static auto to_channel(u8 c) -> float { return c; }
+  static auto from_channel(u32 c) -> u32 { return c; }
+
+  static auto lerp(Pixel const& a, Pixel const& b, float t) -> Pixel { return PW::lerp(a, b, t); }
+  static void blend(Pixel& dst, Pixel src) { PW::blend(dst, src); }
+  static void over(Pixel& dst, Pixel src, u32 opacity) { PW::over(dst, src, opacity); }
+};
+
+struct Linear {
+  static constexpr float channel_max = 4095.f;
+  static auto to_channel(u8 c) -> float { return srgb_tables.to_linear[c]; }
+  static auto from_channel(u32 c) -> u32 { return srgb_tables.to_srgb[c]; }
+
+  // Most pixels a gradient covers are saturated at one end, so those skip
+  // the tables.
+  static auto lerp(Pixel const& a, Pixel const& b, float t) -> Pixel {
+    if (t <= 0.f)
+      return a;
+    if (t >= 1.f)
+      return b;
+    auto const& tables = srgb_tables;
+    Pixel c;
+    c.alpha = a.alpha + (b.alpha - a.alpha) * t;
+    for (auto i = 1u; i < 4u; ++i) {
+      int la = tables.to_linear[a[i]];
+      int lb = tables.to_linear[b[i]];
+      c[i] = tables.to_srgb[static_cast<int>(la + (lb - la) * t)];
+    }
+    return c;
+  }
+
+  static void blend(Pixel& dst, Pixel src) {
+    if (!src.alpha)
+      return;
+    if (src.alpha == 255) {
+      dst = src;
+      return;
+    }
+    auto const& tables = srgb_tables;
+    int a = src.alpha + (src.alpha >> 7);
+    dst.alpha += ((255 - dst.alpha) * a) >> 8;
+    for (auto i = 1u; i < 4u; ++i) {
+      int ld = tables.to_linear[dst[i]];
+      int ls = tables.to_linear[src[i]];
+      dst[i] = tables.to_srgb[ld + (((ls - ld) * a) >> 8)];
+    }
+  }
+
+  // Premultiplied channels are converted as they are, which matches how
+  // `lerp` and `blend` leave them over a transparent layer.
+  static void over(Pixel& dst, Pixel src, u32 opacity) {
+    if (!std::bit_cast<u32>(src))
+      return;
+    if (src.alpha == 255 && opacity == 256) {
+      dst = src;
+      return;
+    }
+    auto const& tables = srgb_tables;
+    u32 alpha = src.alpha * opacity >> 8;
+    auto keep = 256 - alpha - (alpha >> 7);
+    dst.alpha = min(255u, alpha + (dst.alpha * keep >> 8));
+    for (auto i = 1u; i < 4u; ++i) {
+      u32 c = (tables.to_linear[src[i]] * opacity >> 8) + (tables.to_linear[dst[i]] * keep >> 8);
+      dst[i] = tables.to_srgb[min(4095u, c)];
+    }
+  }
+};
+
+// Coordinates are clamped to this far off the canvas before they are turned
+// into pixels, which keeps the conversion in range (and maps NaN to an edge).
+constexpr float guard_band = 1 << 20;
+
+inline auto guard(float coord) -> float {
+  if (is_nan(coord))
+    return -guard_band;
+  return coord > -guard_band ? min(coord, guard_band) : -guard_band;
+}
+
+inline int clip_row(Canvas const& canvas, int i) {
+  return max(canvas.clip.y0, min(canvas.clip.y1, i));
+}
+
+// Edges are evaluated for this many rows at a time, in loops the compiler
+// can vectorize, before the rows' spans are emitted.
+constexpr int band_rows = 8;
+
+inline bool culled(Canvas const& canvas, Point lo, Point hi) {
+  auto const& clip = canvas.clip;
+  return hi.x < clip.x0 || hi.y < clip.y0 || lo.x > clip.x1 || lo.y > clip.y1;
+}
+
+inline auto clamp01(float t) -> float { return max(0.f, min(1.f, t)); }
+
+// Ramp coordinates are 16.16 fixed point, one unit of t per 65536. They are
+// clamped to this far out, which keeps the conversion in range and maps NaN
+// to an end, as guard does for pixels.
+constexpr float ramp_band = 1 << 30;
+
+inline auto to_ramp(float t) -> int {
+  auto ramp = is_nan(t) ? -ramp_band : t * 65536.f;
+  return static_cast<int>(ramp > -ramp_band ? min(ramp, ramp_band) : -ramp_band);
+}
+
+inline auto ramp_index(int t, Spread spread) -> u32 {
+  switch (spread) {
+    case Spread::pad:
+      t = max(0, min(0xffff, t));
+      break;
+    case Spread::repeat:
+      t &= 0xffff;
+      break;
+    case Spread::reflect:
+      t &= 0x1ffff;
+      if (t > 0xffff)
+        t = 0x1ffff - t;
+      break;
+  }
+  return static_cast<u32>(t) >> 8;
+}
+
+// The span kernels fill `n` pixels starting at `out`, whose center is `p`.
+
+template <class Mix = Srgb>
+void span(Pixel* out, u32 n, Point, Solid const& solid) {
+  for (u32 k = 0; k < n; ++k)
+    out[k] = solid.color;
+}
+
+template <class Mix = Srgb>
+void span(Pixel* out, u32 n, Point p, LinearGradient const& gradient) {
+  auto t0 = dot(p - gradient.position, gradient.direction);
+  auto dt = gradient.direction.x;
+  for (u32 k = 0; k < n; ++k)
+    out[k] = Mix::lerp(gradient.color, out[k], clamp01(t0 + k * dt));
+}
+
+template <class Mix = Srgb>
+void span(Pixel* out, u32 n, Point p, RadialGradient const& radial) {
+  auto dx = p.x - radial.position.x;
+  auto dy = p.y - radial.position.y;
+  auto dy2 = dy * dy;
+  auto scale = 1.f / radial.thickness;
+  auto offset = -radial.start_radius * scale;
+  for (u32 k = 0; k < n; ++k) {
+    auto x = dx + k;
+    auto t = clamp01(fast_sqrt(x * x + dy2) * scale + offset);
+    out[k] = Mix::lerp(out[k], radial.color, t);
+  }
+}
+
+template <class Mix = Srgb>
+void span(Pixel* out, u32 n, Point p, LinearRamp const& gradient) {
+  // Stepped in float, since a fixed point step would lose its fraction on
+  // every pixel.
+  auto t0 = dot(p - gradient.position, gradient.direction);
+  auto dt = gradient.direction.x;
+  auto const& ramp = gradient.ramp->color;
+  for (u32 k = 0; k < n; ++k)
+    Mix::blend(out[k], ramp[ramp_index(to_ramp(t0 + k * dt), gradient.spread)]);
+}
+
+template <class Mix = Srgb>
+void span(Pixel* out, u32 n, Point p, RadialRamp const& radial) {
+  auto dx = p.x - radial.center.x;
+  auto dy = p.y - radial.center.y;
+  auto dy2 = dy * dy;
+  auto scale = 1.f / radial.thickness;
+  auto offset = -radial.start_radius * scale;
+  auto const& ramp = radial.ramp->color;
+  for (u32 k = 0; k < n; ++k) {
+    auto x = dx + k;
+    auto t = to_ramp(fast_sqrt(x * x + dy2) * scale + offset);
+    Mix::blend(out[k], ramp[ramp_index(t, radial.spread)]);
+  }
+}
+
+template <class Mix = Srgb>
+void span(Pixel* out, u32 n, Point p, LayerFill const& layer) {
+  auto i = static_cast<int>(p.y) - layer.top;
+  auto j = static_cast<int>(p.x) - layer.left;
+  auto src = &layer.data[i * static_cast<int>(layer.stride) + j];
+  auto opacity = layer.opacity + (layer.opacity >> 7);
+  for (u32 k = 0; k < n; ++k)
+    Mix::over(out[k], src[k], opacity);
+}
+
+template <class Mix = Srgb>
+void span(Pixel* out, u32 n, Point p, MaskFill const& mask) {
+  auto i = static_cast<int>(p.y) - mask.top;
+  auto j = static_cast<int>(p.x) - mask.left;
+  auto coverage = &mask.data[i * static_cast<int>(mask.stride) + j];
+  auto color = mask.color;
+  u32 alpha = mask.color.alpha;
+  // Glyph and shadow masks are mostly empty or fully covered, and those
+  // pixels need no blend.
+  for (u32 k = 0; k < n; ++k) {
+    if (!coverage[k])
+      continue;
+    if ((coverage[k] & alpha) == 255) {
+      out[k] = mask.color;
+      continue;
+    }
+    color.alpha = ((alpha * coverage[k] + 128) * 257) >> 16;
+    Mix::blend(out[k], color);
+  }
+}
+
+// Each channel is a plane over the triangle, stepped from the span's start,
+// with the color channels in the units of `Mix`. Pixels are worked out a
+// batch at a time into a buffer, packed as words so that the stepping
+// vectorizes apart from the blend.
+template <class Mix = Srgb>
+void span(Pixel* out, u32 n, Point p, Gouraud const& gouraud) {
+  constexpr u32 batch = 64;
+  auto const& colors = gouraud.colors;
+  auto u = gouraud.u[0] * p.x + gouraud.u[1] * p.y + gouraud.u[2];
+  auto v = gouraud.v[0] * p.x + gouraud.v[1] * p.y + gouraud.v[2];
+  float start[4];
+  float step[4];
+  float top[4];
+  for (auto c = 0u; c < 4u; ++c) {
+    auto channel = [&](Pixel const& color) { return c ? Mix::to_channel(color[c]) : color[c]; };
+    auto du = channel(colors[1]) - channel(colors[0]);
+    auto dv = channel(colors[2]) - channel(colors[0]);
+    start[c] = channel(colors[0]) + u * du + v * dv + .5f;
+    step[c] = gouraud.u[0] * du + gouraud.v[0] * dv;
+    top[c] = c ? Mix::channel_max : 255.f;
+  }
+  auto opaque = (colors[0].alpha & colors[1].alpha & colors[2].alpha) == 255;
+  u32 buffer[batch];
+  for (u32 k0 = 0; k0 < n; k0 += batch) {
+    auto m = min(n - k0, batch);
+    for (u32 k = 0; k < m; ++k) {
+      auto channel = [&](u32 c) { return static_cast<u32>(min(top[c], max(0.f, start[c] + (k0 + k) * step[c]))); };
+      buffer[k] = channel(0) | Mix::from_channel(channel(1)) << 8 | Mix::from_channel(channel(2)) << 16 |
+        Mix::from_channel(channel(3)) << 24;
+    }
+    if (opaque) {
+      for (u32 k = 0; k < m; ++k)
+        out[k0 + k] = std::bit_cast<Pixel>(buffer[k]);
+      continue;
+    }
+    for (u32 k = 0; k < m; ++k)
+      Mix::blend(out[k0 + k], std::bit_cast<Pixel>(buffer[k]));
+  }
+}
+
+// Samples the pattern's texture, see texture.cc.
+template <class Mix = Srgb>
+void span(Pixel* out, u32 n, Point p, Pattern const& pattern);
+
+template <class Fill>
+auto fill_cast(FillData const& data) -> Fill const& {
+  return reinterpret_cast<Fill const&>(data);
+}
+
+template <class Mix = Srgb>
+void span(Pixel* out, u32 n, Point p, u8 fill_type, FillData const& fill) {
+  switch (fill_type) {
+    case RadialGradient::fill_type:
+      return span<Mix>(out, n, p, fill_cast<RadialGradient>(fill));
+    case Solid::fill_type:
+      return span<Mix>(out, n, p, fill_cast<Solid>(fill));
+    case LinearGradient::fill_type:
+      return span<Mix>(out, n, p, fill_cast<LinearGradient>(fill));
+    case LinearRamp::fill_type:
+      return span<Mix>(out, n, p, fill_cast<LinearRamp>(fill));
+    case RadialRamp::fill_type:
+      return span<Mix>(out, n, p, fill_cast<RadialRamp>(fill));
+    case Pattern::fill_type:
+      return span<Mix>(out, n, p, fill_cast<Pattern>(fill));
+    case LayerFill::fill_type:
+      return span<Mix>(out, n, p, fill_cast<LayerFill>(fill));
+    case MaskFill::fill_type:
+      return span<Mix>(out, n, p, fill_cast<MaskFill>(fill));
+    case Gouraud::fill_type:
+      return span<Mix>(out, n, p, fill_cast<Gouraud>(fill));
+  }
+}
+
+// Slow path for canvases with occlusion, stats, tiles, a capture or a draw
+// list attached, see fill.cc.
+void hooked_setrow(Canvas& canvas, u32 i, u32 j0, u32 j1, u8 fill_type, FillData const& fill);
+
+inline bool hooked(Canvas const& canvas) {
+  return canvas.occlusion || canvas.stats || canvas.tiles || canvas.capture || canvas.draw_list;
+}
+
+// See draw-list.hh.
+void next_item(DrawList& list);
+
+// Called as each primitive starts. Front-to-back mode draws every primitive
+// twice, so only its second pass counts them.
+inline void count_primitive(Canvas& canvas, u32 edges = 0) {
+  if (canvas.stats && !(canvas.occlusion && canvas.occlusion->opaque_pass)) {
+    canvas.stats->primitives += 1;
+    canvas.stats->edges += edges;
+  }
+  if (canvas.draw_list)
+    next_item(*canvas.draw_list);
+  if (auto occlusion = canvas.occlusion)
+    if ((occlusion->layer & Occlusion::max_primitive) < Occlusion::max_primitive)
+      occlusion->layer += 1;
+}
+
+// Spans are clipped here, once per row; the kernels never see a pixel
+// outside the clip rect.
+inline bool clip_span(Canvas const& canvas, int i, int& j0, int& j1) {
+  auto const& clip = canvas.clip;
+  j0 = max(j0, clip.x0);
+  j1 = min(j1, clip.x1);
+  return i >= clip.y0 && i < clip.y1 && j0 < j1;
+}
+
+template <class Fill>
+void setrow(Canvas& canvas, int i, int j0, int j1, Fill const& fill) {
+  if (!clip_span(canvas, i, j0, j1))
+    return;
+  if (hooked(canvas)) {
+    FillData data;
+    reinterpret_cast<Fill&>(data) = fill;
+    return hooked_setrow(canvas, i, j0, j1, Fill::fill_type, data);
+  }
+  if (canvas.gamma_correct)
+    return span<Linear>(&canvas.at(i, j0), j1 - j0, {j0 + .5f, i + .5f}, fill);
+  span(&canvas.at(i, j0), j1 - j0, {j0 + .5f, i + .5f}, fill);
+}
+
+inline void setrow(Canvas& canvas, int i, int j0, int j1, u8 fill_type, FillData const& fill) {
+  if (!clip_span(canvas, i, j0, j1))
+    return;
+  if (hooked(canvas))
+    return hooked_setrow(canvas, i, j0, j1, fill_type, fill);
+  if (canvas.gamma_correct)
+    return span<Linear>(&canvas.at(i, j0), j1 - j0, {j0 + .5f, i + .5f}, fill_type, fill);
+  span(&canvas.at(i, j0), j1 - j0, {j0 + .5f, i + .5f}, fill_type, fill);
+}
+
+void reset(Occlusion& occlusion, u32 height);
+void fill_background(Canvas& canvas, Pixel color);
+void draw_heatmap(Canvas& canvas, Stats const& stats);
+
+}
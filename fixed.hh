@@ -0,0 +1,56 @@
+#pragma once
+
+#include "canvas.hh"
+#include "fill.hh"
+
+#include <cmath>
+#include <cstdint>
+
+namespace PW {
+
+// Fixed-point geometry. Coordinates are 24.8 fixed point and slopes 16.16,
+// so span endpoints come out of integer arithmetic alone and don't depend on
+// how the compiler treats floats.
+
+inline auto to_fixed(float coord) -> int {
+  return static_cast<int>(floor(guard(coord) * 256.f + .5f));
+}
+
+// Slopes are kept to 4096 pixels per row, which keeps the products below in
+// 64 bits anywhere inside the guard band.
+constexpr int64_t max_fixed_slope = int64_t(1) << 28;
+
+inline auto clamp_slope(int64_t slope) -> int64_t {
+  return max(-max_fixed_slope, min(max_fixed_slope, slope));
+}
+
+inline auto to_fixed_slope(float slope) -> int64_t {
+  return static_cast<int64_t>(max(-4096.f, min(4096.f, slope)) * 65536.f);
+}
+
+// Slope of the line through two 24.8 points, in x per y.
+inline auto fixed_slope(int x0, int y0, int x1, int y1) -> int64_t {
+  return clamp_slope((int64_t(x1 - x0) << 16) / (y1 - y0));
+}
+
+// The first row or column whose center is at or after `coord`, that is
+// ceil(coord - .5). Float paths agree with this except for exact halves.
+inline int fixed_to_pixel(int coord) { return (coord + 127) >> 8; }
+
+// Steps down a line one pixel row at a time. `x` is in 24.8 with 16 more
+// fraction bits, so adding the 16.16 slope per row is exact.
+struct FixedLine {
+  int64_t x;
+  int64_t step;
+
+  int column() const { return static_cast<int>((x - (int64_t(128) << 16) + (int64_t(1) << 24) - 1) >> 24); }
+  void next() { x += step; }
+};
+
+// The line through (x, y) with `slope`, at the center of `row`.
+inline auto fixed_line(int x, int y, int64_t slope, int row) -> FixedLine {
+  int64_t center = row * 256 + 128;
+  return {(int64_t(x) << 16) + (center - y) * slope, slope * 256};
+}
+
+}
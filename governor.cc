@@ -0,0 +1,29 @@
+#include "governor.hh"
+
+namespace PW {
+
+void set_budget(Governor& governor, double budget) {
+  governor = {};
+  governor.budget = max(0., budget);
+}
+
+bool report(Governor& governor, double cost) {
+  if (!governor.budget)
+    return false;
+  governor.overloaded = cost > governor.budget ? governor.overloaded + 1 : 0;
+  governor.relaxed = cost < governor.budget * Governor::headroom ? governor.relaxed + 1 : 0;
+
+  auto level = governor.level;
+  if (governor.overloaded == Governor::overloaded_paints && level + 1 < Governor::levels)
+    level += 1;
+  else if (governor.relaxed == Governor::relaxed_paints && level > 0)
+    level -= 1;
+  else
+    return false;
+  governor.level = level;
+  governor.overloaded = 0;
+  governor.relaxed = 0;
+  return true;
+}
+
+}
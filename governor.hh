@@ -0,0 +1,30 @@
+#pragma once
+
+#include "canvas.hh"
+
+namespace PW {
+
+// Picks a quality level from how long recent paints took against a budget.
+// Level 0 is full quality, and each level up gives up more. A few paints in
+// a row over budget step the level up; a longer run of paints well under it
+// steps it back down, so a level is tried again only once there is clearly
+// room for it. Counts restart at every step, so each level is judged by its
+// own paints.
+struct Governor {
+  enum { levels = 4, overloaded_paints = 3, relaxed_paints = 30 };
+  // Paints under this fraction of the budget count as relaxed.
+  static constexpr double headroom = .5;
+
+  // In seconds; 0 turns the governor off and keeps full quality.
+  double budget {};
+  u32 level {};
+  u32 overloaded {};
+  u32 relaxed {};
+};
+
+void set_budget(Governor& governor, double budget);
+// Takes the duration of a paint, in seconds, and returns whether the level
+// changed.
+bool report(Governor& governor, double cost);
+
+}
@@ -1,6 +1,85 @@
+struct SysStats {
+  unsigned primitives;
+  unsigned edges;
+  unsigned spans;
+  unsigned pixels[16];
+  unsigned overdrawn;
+};
+
+struct SysTiming {
+  float paint_ms;
+  float latency_ms;
+  unsigned frames;
+  unsigned coalesced;
+  // One of SysQuality.
+  unsigned quality;
+};
+
+struct SysRecording {
+  unsigned recorded;
+  unsigned dropped;
+};
+
+// Tiles of `tile_size` pixels that changed in the last paint, one bit per
+// tile, row by row, 32 to a word. `bits` stays valid until the next paint.
+struct SysChanges {
+  unsigned tile_size;
+  unsigned columns;
+  unsigned rows;
+  unsigned changed;
+  unsigned const* bits;
+};
+
+enum SysDebug { SysDebugStats = 1, SysDebugHeatmap = 2 };
+
+// Quality levels, from full quality down. Each level also keeps the cuts of
+// the levels before it.
+enum SysQuality {
+  SysQualityFull,
+  // No hover highlights on the handles and no drop shadow.
+  SysQualityNoDecorations,
+  // Curves in a quarter of the pieces.
+  SysQualityCoarseCurves,
+  // Curves and the triangle drawn without antialiasing.
+  SysQualityNoAntialiasing,
+};
+
+// Systems share no mutable state, so different systems may paint on different
+// threads at once. Each system must only be used by one thread at a time.
 void* sysInit(void (*redraw)(void const*));
 void sysKill(void* sys);
 void sysPaint(void* sys, unsigned* data, unsigned width, unsigned height, unsigned stride);
+// Paints a frame of any size in strips of at most `strip_height` rows,
+// passing each one to `sink` as it is finished. The strip buffer is reused,
+// and strips are made shorter to keep it under 1 GB. Returns 0, painting
+// nothing, when a size is 0 or a single row would not fit.
+int sysPaintStrips(void* sys, unsigned width, unsigned height, unsigned strip_height,
+  void (*sink)(void const* user, unsigned const* data, unsigned top, unsigned rows, unsigned stride), void const* user);
+int sysCapture(void* sys, char const* path, unsigned* data, unsigned width, unsigned height, unsigned stride);
+int sysStartRecording(void* sys, char const* path);
+void sysStopRecording(void* sys);
+void sysRecording(void* sys, struct SysRecording* recording);
+void sysSetFrontToBack(void* sys, int enabled);
+void sysSetTiled(void* sys, int enabled);
+// Draws on `threads` threads, counting the painting thread; 0 turns it off.
+void sysSetParallel(void* sys, unsigned threads);
+void sysSetFixedPoint(void* sys, int enabled);
+void sysSetGammaCorrect(void* sys, int enabled);
+// Without tracking, every tile is reported as changed.
+void sysSetTrackChanges(void* sys, int enabled);
+void sysChanges(void* sys, struct SysChanges* changes);
+void sysSetDebug(void* sys, unsigned flags);
+void sysStats(void* sys, struct SysStats* stats);
+// Paces paints to at most this many per second; 0 or less turns pacing off,
+// so paints only wait for the one before.
+void sysSetFrameRate(void* sys, float frames_per_second);
+// Lowers quality when paints keep taking longer than `milliseconds`, and
+// raises it again once they take well under; 0 turns this off and restores
+// full quality. The level is reported in SysTiming.
+void sysSetFrameBudget(void* sys, float milliseconds);
+double sysPaintDelay(void* sys);
+void sysPresented(void* sys);
+void sysTiming(void* sys, struct SysTiming* timing);
 void sysMouseDown(void* sys, void const* user, float x, float y);
 void sysMouseUp(void* sys, void const* user, float x, float y);
 void sysMouseMoved(void* sys, void const* user, float x, float y);
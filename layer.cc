@@ -0,0 +1,112 @@
+#include "layer.hh"
+#include "fill.hh"
+
+#include <cstdlib>
+
+namespace PW {
+
+namespace {
+
+bool operator==(Rect const& a, Rect const& b) {
+  return a.x0 == b.x0 && a.y0 == b.y0 && a.x1 == b.x1 && a.y1 == b.y1;
+}
+
+// Takes the smallest free buffer that fits, else grows the largest free one.
+u32 acquire(LayerPool& pool, u32 size) {
+  u32 fitting = 0;
+  u32 largest = 0;
+  for (u32 k = 1; k <= len(pool.buffers); ++k) {
+    auto const& buffer = pool.buffers[k - 1];
+    if (buffer.used)
+      continue;
+    if (buffer.capacity >= size && (!fitting || buffer.capacity < pool.buffers[fitting - 1].capacity))
+      fitting = k;
+    if (!largest || buffer.capacity > pool.buffers[largest - 1].capacity)
+      largest = k;
+  }
+  auto best = fitting ? fitting : largest;
+  if (!best) {
+    pool.buffers.push({nullptr, 0, false});
+    best = len(pool.buffers);
+  }
+  auto& buffer = pool.buffers[best - 1];
+  if (buffer.capacity < size) {
+    buffer.data = static_cast<Pixel*>(realloc(buffer.data, size * sizeof(Pixel)));
+    if (!buffer.data)
+      abort();
+    buffer.capacity = size;
+  }
+  buffer.used = true;
+  return best;
+}
+
+}
+
+LayerPool::~LayerPool() {
+  for (auto& buffer: buffers)
+    free(buffer.data);
+}
+
+// Layers are cut to the canvas, not to its clip, so one drawn for a strip
+// stays valid for the next and a shadow sees all of it.
+bool push_layer(Canvas const& canvas, LayerPool& pool, Layer& layer, Rect bounds, Canvas& group) {
+  auto width = static_cast<int>(canvas.width);
+  auto height = static_cast<int>(canvas.height);
+  bounds = {max(bounds.x0, 0), max(bounds.y0, 0), min(bounds.x1, width), min(bounds.y1, height)};
+  bounds.x1 = max(bounds.x0, bounds.x1);
+  bounds.y1 = max(bounds.y0, bounds.y1);
+  if (layer.valid && layer.bounds == bounds)
+    return false;
+
+  auto layer_width = static_cast<u32>(bounds.x1 - bounds.x0);
+  auto size = layer_width * static_cast<u32>(bounds.y1 - bounds.y0);
+  if (!layer.buffer || pool.buffers[layer.buffer - 1].capacity < size) {
+    release(pool, layer);
+    layer.buffer = acquire(pool, size);
+  }
+  layer.bounds = bounds;
+  layer.valid = false;
+
+  auto data = pool.buffers[layer.buffer - 1].data;
+  for (u32 k = 0; k < size; ++k)
+    data[k] = {0, 0, 0, 0};
+
+  group = {data, canvas.width, canvas.height, layer_width};
+  group.stats = canvas.stats;
+  group.clip = bounds;
+  group.left = bounds.x0;
+  group.top = bounds.y0;
+  group.fixed_point = canvas.fixed_point;
+  group.gamma_correct = canvas.gamma_correct;
+  return true;
+}
+
+void pop_layer(Canvas& canvas, LayerPool const& pool, Layer& layer, u8 opacity) {
+  layer.valid = true;
+  auto const& bounds = layer.bounds;
+  if (!layer.buffer || bounds.x0 == bounds.x1 || !opacity)
+    return;
+  count_primitive(canvas);
+  auto fill = LayerFill {pool.buffers[layer.buffer - 1].data, static_cast<u32>(bounds.x1 - bounds.x0), bounds.x0, bounds.y0, opacity};
+  for (auto i = bounds.y0; i < bounds.y1; ++i)
+    setrow(canvas, i, bounds.x0, bounds.x1, fill);
+}
+
+void release(LayerPool& pool, Layer& layer) {
+  if (layer.buffer)
+    pool.buffers[layer.buffer - 1].used = false;
+  layer.buffer = 0;
+  layer.valid = false;
+}
+
+void trim(LayerPool& pool) {
+  for (auto& buffer: pool.buffers) {
+    if (buffer.used)
+      continue;
+    free(buffer.data);
+    buffer.data = nullptr;
+    buffer.capacity = 0;
+  }
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "canvas.hh"
+#include "list.hh"
+
+namespace PW {
+
+// Buffers for layers, kept and reused across frames.
+struct LayerPool {
+  struct Buffer {
+    Pixel* data;
+    u32 capacity;
+    bool used;
+  };
+
+  LayerPool() = default;
+  LayerPool(LayerPool const&) = delete;
+  ~LayerPool();
+
+  List<Buffer> buffers;
+};
+
+// A group of primitives drawn into its own premultiplied buffer, covering
+// only `bounds`, and composited as one. Its contents are kept until it is
+// invalidated or its bounds change.
+struct Layer {
+  Rect bounds {};
+  u32 buffer {};
+  bool valid {};
+};
+
+// Returns whether the group has to be drawn, into `group`. When it returns
+// false the kept contents are still good and only pop_layer is needed.
+bool push_layer(Canvas const& canvas, LayerPool& pool, Layer& layer, Rect bounds, Canvas& group);
+void pop_layer(Canvas& canvas, LayerPool const& pool, Layer& layer, u8 opacity);
+void release(LayerPool& pool, Layer& layer);
+// Frees the buffers no layer holds, giving back what a large paint grew.
+void trim(LayerPool& pool);
+
+inline void invalidate(Layer& layer) { layer.valid = false; }
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "canvas.hh"
+
+#include <cstdlib>
+#include <type_traits>
+#include <utility>
+
+namespace PW {
+
+using std::exchange;
+
+struct Blob {
+  Blob(): data() {}
+  Blob(unsigned size);
+  Blob(Blob const&) = delete;
+  Blob(Blob&& other): data(exchange(other.data, nullptr)) {}
+  Blob(Blob&& other, unsigned size);
+  ~Blob();
+  void operator=(Blob&& other) { data = exchange(other.data, nullptr); }
+  char& operator[](unsigned i) { return data[i]; }
+  char const& operator[](unsigned i) const { return data[i]; }
+
+private:
+  char* data;
+};
+
+inline Blob::Blob(unsigned size): data((char*) malloc(size)) {}
+
+inline Blob::Blob(Blob&& other, unsigned size):
+  data((char*) realloc(exchange(other.data, nullptr), size)) {}
+
+inline Blob::~Blob() { free(exchange(data, nullptr)); }
+
+template <class T>
+constexpr bool is_trivial = std::is_trivial_v<T>;
+
+template <class T>
+struct List {
+  static_assert(is_trivial<T>);
+  void push(T const& x) {
+    expand(count + 1);
+    begin()[count++] = x;
+  }
+  T& operator[](u32 index) { return begin()[index]; }
+  T const& operator[](u32 index) const { return begin()[index]; }
+  T* begin() { return reinterpret_cast<T*>(&data[0]); }
+  T const* begin() const { return reinterpret_cast<T const*>(&data[0]); }
+  T* end() { return begin() + count; }
+  T const* end() const { return begin() + count; }
+  friend u32 len(List const& list) { return list.count; }
+  void resize(u32 size) {
+    expand(size);
+    count = size;
+  }
+  void clear() { count = 0; }
+private:
+  Blob data;
+  u32 count {};
+  u32 capacity {};
+  T* at(u32 index) { return reinterpret_cast<T*>(&data[0]) + index; }
+  void expand(u32 needed) {
+    if (capacity >= needed)
+      return;
+    if (!capacity) {
+      capacity = needed;
+    } else {
+      while (capacity < needed)
+        capacity *= 2;
+    }
+    data = Blob(std::move(data), capacity * sizeof(T));
+  }
+};
+
+}
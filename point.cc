@@ -1,4 +1,5 @@
 #include "canvas.hh"
+#include "fill.hh"
 
 #include <cmath>
 
@@ -11,11 +12,6 @@ void lerp(Pixel& a, Pixel const& b, float t) {
     a[i] += (b[i] - a[i]) * t;
 }
 
-template <class T>
-T const& max(T const& a, T const& b) {
-  return (a < b) ? b : a;
-}
-
 auto sqr(float value) -> float { return value * value; }
 
 }
@@ -23,15 +19,19 @@ auto sqr(float value) -> float { return value * value; }
 void point(Canvas& canvas, Point point) {
   auto x = point.x - .5f;
   auto y = point.y - .5f;
+  if (culled(canvas, {x, y}, {x + 2.f, y + 2.f}))
+    return;
   auto i0 = static_cast<int>(floor(y));
-  auto i1 = i0 + 1;
   auto j0 = static_cast<int>(floor(x));
-  auto j1 = j0 + 1;
+  auto const& clip = canvas.clip;
   auto color = Pixel {255, 255, 0, 255};
-  lerp(canvas.data[i0 * canvas.stride + j0], color, max(0.f, 1.f - sqrt(sqr(j0 - x) + sqr(i0 - y))));
-  lerp(canvas.data[i0 * canvas.stride + j1], color, max(0.f, 1.f - sqrt(sqr(j1 - x) + sqr(i0 - y))));
-  lerp(canvas.data[i1 * canvas.stride + j0], color, max(0.f, 1.f - sqrt(sqr(j0 - x) + sqr(i1 - y))));
-  lerp(canvas.data[i1 * canvas.stride + j1], color, max(0.f, 1.f - sqrt(sqr(j1 - x) + sqr(i1 - y))));
+  for (auto i = i0; i < i0 + 2; ++i) {
+    if (i < clip.y0 || i >= clip.y1)
+      continue;
+    for (auto j = j0; j < j0 + 2; ++j)
+      if (j >= clip.x0 && j < clip.x1)
+        lerp(canvas.at(i, j), color, max(0.f, 1.f - sqrt(sqr(j - x) + sqr(i - y))));
+  }
 }
 
 }
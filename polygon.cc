@@ -0,0 +1,208 @@
+#include "polygon.hh"
+#include "fill.hh"
+#include "fixed.hh"
+#include "math.hh"
+
+#include <cmath>
+
+namespace PW {
+
+namespace {
+
+int to_pixel(float coord) {
+  return static_cast<int>(ceil(guard(coord) - .5f));
+}
+
+// Calls `body` with the fill cast to its type, so that the scan below is
+// compiled for each fill rather than dispatching on every span.
+void visit(u8 fill_type, FillData const& fill, auto const& body) {
+  switch (fill_type) {
+    case RadialGradient::fill_type:
+      return body(fill_cast<RadialGradient>(fill));
+    case Solid::fill_type:
+      return body(fill_cast<Solid>(fill));
+    case LinearGradient::fill_type:
+      return body(fill_cast<LinearGradient>(fill));
+    case LinearRamp::fill_type:
+      return body(fill_cast<LinearRamp>(fill));
+    case RadialRamp::fill_type:
+      return body(fill_cast<RadialRamp>(fill));
+    case Pattern::fill_type:
+      return body(fill_cast<Pattern>(fill));
+    case LayerFill::fill_type:
+      return body(fill_cast<LayerFill>(fill));
+    case MaskFill::fill_type:
+      return body(fill_cast<MaskFill>(fill));
+    case Gouraud::fill_type:
+      return body(fill_cast<Gouraud>(fill));
+  }
+}
+
+// Both sides start at the top corner and walk down to the bottom one, one
+// going forward through the corners and the other backward. A side sets up
+// each of its edges once, when it reaches the edge's first row. Between
+// corners both edges stay put, so those rows are evaluated a band at a time;
+// which side is left only matters per row, so winding doesn't.
+template <class Fill>
+void scan(Canvas& canvas, Point const* points, u32 count, u32 top, u32 bottom, Fill const& fill) {
+  struct Side {
+    u32 at;
+    u32 step;
+    Point from;
+    float slope;
+    float end;
+  };
+  auto set = [&](Side& side) {
+    auto from = points[side.at];
+    auto to = points[(side.at + side.step) % count];
+    side.from = from;
+    side.slope = to.y > from.y ? (to.x - from.x) / (to.y - from.y) : 0.f;
+    side.end = to.y;
+  };
+  auto reach = [&](Side& side, float y) {
+    while (side.end <= y && side.at != bottom) {
+      side.at = (side.at + side.step) % count;
+      set(side);
+    }
+  };
+
+  Side a {top, 1};
+  Side b {top, count - 1};
+  set(a);
+  set(b);
+  auto end = clip_row(canvas, to_pixel(points[bottom].y));
+  for (auto i = clip_row(canvas, to_pixel(points[top].y)); i < end;) {
+    reach(a, i + .5f);
+    reach(b, i + .5f);
+    auto corner = max(i + 1, min(end, min(to_pixel(a.end), to_pixel(b.end))));
+    for (auto band = i; band < corner; band += band_rows) {
+      float xa[band_rows];
+      float xb[band_rows];
+      for (auto r = 0; r < band_rows; ++r) {
+        auto y = band + r + .5f;
+        xa[r] = a.from.x + (y - a.from.y) * a.slope;
+        xb[r] = b.from.x + (y - b.from.y) * b.slope;
+      }
+      for (auto r = 0, rows = min(band_rows, corner - band); r < rows; ++r)
+        setrow(canvas, band + r, to_pixel(min(xa[r], xb[r])), to_pixel(max(xa[r], xb[r])), fill);
+    }
+    i = corner;
+  }
+}
+
+// Same as scan, with the setup and stepping in fixed point.
+template <class Fill>
+void scan_fixed(Canvas& canvas, Point const* points, u32 count, u32 top, u32 bottom, Fill const& fill) {
+  struct Side {
+    u32 at;
+    u32 step;
+    FixedLine line;
+    int end;
+  };
+  auto set = [&](Side& side, int row) {
+    auto const& from = points[side.at];
+    auto const& to = points[(side.at + side.step) % count];
+    int x0 = to_fixed(from.x), y0 = to_fixed(from.y);
+    int x1 = to_fixed(to.x), y1 = to_fixed(to.y);
+    side.line = fixed_line(x0, y0, y1 > y0 ? fixed_slope(x0, y0, x1, y1) : 0, row);
+    side.end = fixed_to_pixel(y1);
+  };
+  auto reach = [&](Side& side, int row) {
+    while (side.end <= row && side.at != bottom) {
+      side.at = (side.at + side.step) % count;
+      set(side, row);
+    }
+  };
+
+  auto i0 = max(fixed_to_pixel(to_fixed(points[top].y)), canvas.clip.y0);
+  auto i1 = min(fixed_to_pixel(to_fixed(points[bottom].y)), canvas.clip.y1);
+  Side a {top, 1};
+  Side b {top, count - 1};
+  set(a, i0);
+  set(b, i0);
+  for (auto i = i0; i < i1; ++i) {
+    reach(a, i);
+    reach(b, i);
+    auto ja = a.line.column();
+    auto jb = b.line.column();
+    setrow(canvas, i, min(ja, jb), max(ja, jb), fill);
+    a.line.next();
+    b.line.next();
+  }
+}
+
+// The bounds of a polygon and its top and bottom corners.
+struct Extent {
+  Point lo;
+  Point hi;
+  u32 top;
+  u32 bottom;
+};
+
+auto measure(Point const* points, u32 count) -> Extent {
+  Extent extent {points[0], points[0], 0, 0};
+  for (u32 k = 1; k < count; ++k) {
+    auto p = points[k];
+    extent.lo = {min(extent.lo.x, p.x), min(extent.lo.y, p.y)};
+    extent.hi = {max(extent.hi.x, p.x), max(extent.hi.y, p.y)};
+    if (p.y < points[extent.top].y)
+      extent.top = k;
+    if (p.y > points[extent.bottom].y)
+      extent.bottom = k;
+  }
+  return extent;
+}
+
+void draw(Canvas& canvas, Point const* points, u32 count, Extent const& extent, u8 fill_type, FillData const& fill) {
+  visit(fill_type, fill, [&](auto const& fill) {
+    if (canvas.fixed_point)
+      return scan_fixed(canvas, points, count, extent.top, extent.bottom, fill);
+    scan(canvas, points, count, extent.top, extent.bottom, fill);
+  });
+}
+
+}
+
+void push_polygon(Polygons& polygons, Point const* points, u32 count, u8 fill_type, FillData const& fill) {
+  check(polygons.count < Polygons::max_polygons);
+  check(polygons.point_count + count <= Polygons::max_points);
+  auto index = polygons.count++;
+  polygons.fill_data[index] = fill;
+  polygons.fill_type[index] = fill_type;
+  polygons.first[index] = polygons.point_count;
+  for (u32 k = 0; k < count; ++k)
+    polygons.points[polygons.point_count++] = points[k];
+}
+
+// The whole batch is one primitive, counted before its first visible
+// polygon draws.
+void blit_polygons(Canvas& canvas, Polygons const& polygons) {
+  auto counted = false;
+  for (u32 k = 0; k < polygons.count; ++k) {
+    auto first = polygons.first[k];
+    auto count = (k + 1 < polygons.count ? polygons.first[k + 1] : polygons.point_count) - first;
+    auto points = &polygons.points[first];
+    if (count < 3)
+      continue;
+    auto extent = measure(points, count);
+    if (culled(canvas, extent.lo, extent.hi))
+      continue;
+    if (!counted) {
+      count_primitive(canvas);
+      counted = true;
+    }
+    draw(canvas, points, count, extent, polygons.fill_type[k], polygons.fill_data[k]);
+  }
+}
+
+void blit_polygon(Canvas& canvas, Point const* points, u32 count, u8 fill_type, FillData const& fill) {
+  if (count < 3)
+    return;
+  auto extent = measure(points, count);
+  if (culled(canvas, extent.lo, extent.hi))
+    return;
+  count_primitive(canvas);
+  draw(canvas, points, count, extent, fill_type, fill);
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "canvas.hh"
+#include "edges.hh"
+
+namespace PW {
+
+// Convex polygons, each with its own fill, drawn together as one primitive.
+// Corners may go either way around; polygons that aren't convex draw
+// incorrectly.
+struct Polygons {
+  enum { max_polygons = 256, max_points = 1024 };
+  FillData fill_data[max_polygons];
+  u8 fill_type[max_polygons];
+  u32 first[max_polygons];
+  u32 count {};
+  Point points[max_points];
+  u32 point_count {};
+};
+
+void push_polygon(Polygons& polygons, Point const* points, u32 count, u8 fill_type, FillData const& fill);
+
+template <class T>
+void push_polygon(Polygons& polygons, Point const* points, u32 count, T const& fill) {
+  static_assert(sizeof(T) <= sizeof(FillData));
+  static_assert(alignof(T) <= alignof(FillData));
+  FillData data;
+  reinterpret_cast<T&>(data) = fill;
+  push_polygon(polygons, points, count, T::fill_type, data);
+}
+
+void blit_polygons(Canvas& canvas, Polygons const& polygons);
+
+void blit_polygon(Canvas& canvas, Point const* points, u32 count, u8 fill_type, FillData const& fill);
+
+template <class T>
+void blit_polygon(Canvas& canvas, Point const* points, u32 count, T const& fill) {
+  static_assert(sizeof(T) <= sizeof(FillData));
+  static_assert(alignof(T) <= alignof(FillData));
+  FillData data;
+  reinterpret_cast<T&>(data) = fill;
+  blit_polygon(canvas, points, count, T::fill_type, data);
+}
+
+}
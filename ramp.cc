@@ -0,0 +1,22 @@
+#include "canvas.hh"
+#include "fill.hh"
+#include "math.hh"
+
+void make_ramp(Ramp& ramp, ColorStop const* stops, u32 count) {
+  PW::check(count > 0);
+  u32 next = 0;
+  for (u32 k = 0; k < Ramp::size; ++k) {
+    auto t = (k + .5f) / float(Ramp::size);
+    while (next < count && stops[next].offset <= t)
+      ++next;
+    if (next == 0) {
+      ramp.color[k] = stops[0].color;
+    } else if (next == count) {
+      ramp.color[k] = stops[count - 1].color;
+    } else {
+      auto const& a = stops[next - 1];
+      auto const& b = stops[next];
+      ramp.color[k] = PW::lerp(a.color, b.color, (t - a.offset) / (b.offset - a.offset));
+    }
+  }
+}
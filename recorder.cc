@@ -0,0 +1,172 @@
+#include "recorder.hh"
+
+namespace PW {
+
+namespace {
+
+void put(List<u8>& out, u8 byte) { out.push(byte); }
+
+void put32(List<u8>& out, u32 value) {
+  for (auto shift = 24; shift >= 0; shift -= 8)
+    put(out, value >> shift);
+}
+
+bool operator==(Pixel const& a, Pixel const& b) {
+  return a.alpha == b.alpha && a.red == b.red && a.green == b.green && a.blue == b.blue;
+}
+
+void encode(Recorder& recorder) {
+  List<u8> bytes;
+  std::unique_lock lock {recorder.mutex};
+  for (;;) {
+    recorder.ready.wait(lock, [&] { return recorder.count || recorder.stopping; });
+    if (!recorder.count)
+      return;
+    auto& frame = recorder.frames[recorder.first];
+    lock.unlock();
+
+    bytes.clear();
+    encode_qoi(bytes, frame.pixels.begin(), frame.width, frame.height);
+    fwrite(bytes.begin(), 1, len(bytes), recorder.out);
+
+    lock.lock();
+    recorder.first = (recorder.first + 1) % Recorder::ring_size;
+    recorder.count -= 1;
+    recorder.recorded += 1;
+  }
+}
+
+}
+
+Recorder::~Recorder() {
+  stop(*this);
+}
+
+bool start(Recorder& recorder, char const* path) {
+  stop(recorder);
+  recorder.piped = path[0] == '|';
+  recorder.out = recorder.piped ? popen(path + 1, "w") : fopen(path, "wb");
+  if (!recorder.out)
+    return false;
+  recorder.first = 0;
+  recorder.count = 0;
+  recorder.stopping = false;
+  recorder.recorded = 0;
+  recorder.dropped = 0;
+  recorder.worker = std::thread {encode, std::ref(recorder)};
+  return true;
+}
+
+// Encodes the frames still in the ring, then closes the output.
+void stop(Recorder& recorder) {
+  if (!recorder.out)
+    return;
+  {
+    std::lock_guard lock {recorder.mutex};
+    recorder.stopping = true;
+  }
+  recorder.ready.notify_one();
+  recorder.worker.join();
+  if (recorder.piped)
+    pclose(recorder.out);
+  else
+    fclose(recorder.out);
+  recorder.out = nullptr;
+}
+
+// Only the painting thread submits, so the slot past the queued frames is
+// not touched by the encoder until `count` includes it.
+void submit(Recorder& recorder, Canvas const& canvas) {
+  if (!recorder.out)
+    return;
+  u32 slot;
+  {
+    std::lock_guard lock {recorder.mutex};
+    if (recorder.count == Recorder::ring_size) {
+      recorder.dropped += 1;
+      return;
+    }
+    slot = (recorder.first + recorder.count) % Recorder::ring_size;
+  }
+
+  auto& frame = recorder.frames[slot];
+  frame.width = canvas.width;
+  frame.height = canvas.height;
+  frame.pixels.resize(canvas.width * canvas.height);
+  for (u32 i = 0; i < canvas.height; ++i)
+    for (u32 j = 0; j < canvas.width; ++j)
+      frame.pixels[i * canvas.width + j] = canvas.data[i * canvas.stride + j];
+
+  {
+    std::lock_guard lock {recorder.mutex};
+    recorder.count += 1;
+  }
+  recorder.ready.notify_one();
+}
+
+void encode_qoi(List<u8>& out, Pixel const* pixels, u32 width, u32 height) {
+  for (auto c: "qoif")
+    if (c)
+      put(out, c);
+  put32(out, width);
+  put32(out, height);
+  put(out, 4);
+  put(out, 0);
+
+  Pixel index[64] {};
+  auto previous = Pixel {255, 0, 0, 0};
+  u32 run = 0;
+  auto count = width * height;
+  for (u32 k = 0; k < count; ++k) {
+    auto pixel = pixels[k];
+    if (pixel == previous) {
+      if (++run == 62 || k + 1 == count) {
+        put(out, 0xc0 | (run - 1));
+        run = 0;
+      }
+      continue;
+    }
+    if (run) {
+      put(out, 0xc0 | (run - 1));
+      run = 0;
+    }
+
+    auto hash = (pixel.red * 3 + pixel.green * 5 + pixel.blue * 7 + pixel.alpha * 11) % 64;
+    if (index[hash] == pixel) {
+      put(out, hash);
+    } else {
+      index[hash] = pixel;
+      if (pixel.alpha != previous.alpha) {
+        put(out, 0xff);
+        put(out, pixel.red);
+        put(out, pixel.green);
+        put(out, pixel.blue);
+        put(out, pixel.alpha);
+      } else {
+        auto dr = static_cast<signed char>(pixel.red - previous.red);
+        auto dg = static_cast<signed char>(pixel.green - previous.green);
+        auto db = static_cast<signed char>(pixel.blue - previous.blue);
+        auto dr_dg = dr - dg;
+        auto db_dg = db - dg;
+        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+          put(out, 0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+        } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+          put(out, 0x80 | (dg + 32));
+          put(out, (dr_dg + 8) << 4 | (db_dg + 8));
+        } else {
+          put(out, 0xfe);
+          put(out, pixel.red);
+          put(out, pixel.green);
+          put(out, pixel.blue);
+        }
+      }
+    }
+    previous = pixel;
+  }
+
+  for (auto k = 0; k < 7; ++k)
+    put(out, 0);
+  put(out, 1);
+}
+
+}
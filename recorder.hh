@@ -0,0 +1,51 @@
+#pragma once
+
+#include "canvas.hh"
+#include "list.hh"
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+namespace PW {
+
+// Records finished frames as a stream of QOI images. Frames are copied into
+// a small ring and encoded on a background thread; when the ring is full the
+// frame is dropped, so recording never holds up painting.
+struct Recorder {
+  enum { ring_size = 4 };
+
+  struct Frame {
+    List<Pixel> pixels;
+    u32 width;
+    u32 height;
+  };
+
+  Recorder() = default;
+  Recorder(Recorder const&) = delete;
+  ~Recorder();
+
+  FILE* out {};
+  bool piped {};
+  std::thread worker;
+  std::mutex mutex;
+  std::condition_variable ready;
+  Frame frames[ring_size];
+  u32 first {};
+  u32 count {};
+  bool stopping {};
+  u32 recorded {};
+  u32 dropped {};
+};
+
+// Starts recording to `path`, or to the standard input of a command when
+// `path` starts with '|'.
+bool start(Recorder& recorder, char const* path);
+void stop(Recorder& recorder);
+void submit(Recorder& recorder, Canvas const& canvas);
+
+// Appends `pixels` to `out` as one QOI image.
+void encode_qoi(List<u8>& out, Pixel const* pixels, u32 width, u32 height);
+
+}
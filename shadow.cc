@@ -0,0 +1,124 @@
+#include "shadow.hh"
+#include "fill.hh"
+
+#include <cmath>
+
+namespace PW {
+
+namespace {
+
+// Radii of three box blurs whose sequence approximates a Gaussian.
+void box_radii(float sigma, int radii[3]) {
+  constexpr int n = 3;
+  auto variance = 12.f * sigma * sigma;
+  auto lower = static_cast<int>(sqrt(variance / n + 1.f));
+  if (lower % 2 == 0)
+    --lower;
+  lower = max(lower, 1);
+  auto upper = lower + 2;
+  auto m = static_cast<int>(round((variance - n * lower * lower - 4 * n * lower - 3 * n) / (-4 * lower - 4)));
+  for (int k = 0; k < n; ++k)
+    radii[k] = ((k < m ? lower : upper) - 1) / 2;
+}
+
+// Divides by 2r + 1 in 16.16 fixed point.
+u32 reciprocal(int radius) { return (1u << 16) / (2 * radius + 1); }
+
+// Running sum along each row; the cost does not depend on the radius.
+void blur_rows(u8 const* src, u8* dst, u32 width, u32 height, int radius) {
+  auto scale = reciprocal(radius);
+  int w = width;
+  for (u32 i = 0; i < height; ++i) {
+    auto in = &src[i * width];
+    auto out = &dst[i * width];
+    u32 sum = 0;
+    for (int j = 0; j < min(radius, w); ++j)
+      sum += in[j];
+    for (int j = 0; j < w; ++j) {
+      if (j + radius < w)
+        sum += in[j + radius];
+      out[j] = (sum * scale + 0x8000) >> 16;
+      if (j - radius >= 0)
+        sum -= in[j - radius];
+    }
+  }
+}
+
+// Running sums down the columns, a whole row at a time so that the inner
+// loops run across the row.
+void blur_columns(u8 const* src, u8* dst, u32* sums, u32 width, u32 height, int radius) {
+  auto scale = reciprocal(radius);
+  int h = height;
+  for (u32 j = 0; j < width; ++j)
+    sums[j] = 0;
+  for (int i = 0; i < min(radius, h); ++i)
+    for (u32 j = 0; j < width; ++j)
+      sums[j] += src[i * width + j];
+  for (int i = 0; i < h; ++i) {
+    if (i + radius < h) {
+      auto in = &src[(i + radius) * width];
+      for (u32 j = 0; j < width; ++j)
+        sums[j] += in[j];
+    }
+    auto out = &dst[i * width];
+    for (u32 j = 0; j < width; ++j)
+      out[j] = (sums[j] * scale + 0x8000) >> 16;
+    if (i - radius >= 0) {
+      auto in = &src[(i - radius) * width];
+      for (u32 j = 0; j < width; ++j)
+        sums[j] -= in[j];
+    }
+  }
+}
+
+}
+
+void drop_shadow(Canvas& canvas, LayerPool const& pool, Layer const& layer, Shadow const& shadow, ShadowMask& mask) {
+  auto const& bounds = layer.bounds;
+  if (!layer.buffer || bounds.x0 == bounds.x1 || bounds.y0 == bounds.y1)
+    return;
+
+  int radii[3];
+  box_radii(max(shadow.sigma, 0.f), radii);
+  auto reach = radii[0] + radii[1] + radii[2];
+
+  auto layer_width = static_cast<u32>(bounds.x1 - bounds.x0);
+  auto layer_height = static_cast<u32>(bounds.y1 - bounds.y0);
+  auto width = layer_width + 2 * reach;
+  auto height = layer_height + 2 * reach;
+  auto left = bounds.x0 - reach + static_cast<int>(round(shadow.offset.x));
+  auto top = bounds.y0 - reach + static_cast<int>(round(shadow.offset.y));
+  auto lo = Point {static_cast<float>(left), static_cast<float>(top)};
+  auto hi = Point {static_cast<float>(left + width), static_cast<float>(top + height)};
+  if (culled(canvas, lo, hi))
+    return;
+  count_primitive(canvas);
+
+  mask.mask.resize(width * height);
+  mask.scratch.resize(width * height);
+  mask.sums.resize(width);
+  auto a = mask.mask.begin();
+  auto b = mask.scratch.begin();
+  for (u32 k = 0; k < width * height; ++k)
+    a[k] = 0;
+  auto src = pool.buffers[layer.buffer - 1].data;
+  for (u32 i = 0; i < layer_height; ++i)
+    for (u32 j = 0; j < layer_width; ++j)
+      a[(i + reach) * width + j + reach] = src[i * layer_width + j].alpha;
+
+  // Box blurs commute, so all row passes run before the column passes.
+  for (auto radius: radii) {
+    blur_rows(a, b, width, height, radius);
+    std::swap(a, b);
+  }
+  for (auto radius: radii) {
+    blur_columns(a, b, mask.sums.begin(), width, height, radius);
+    std::swap(a, b);
+  }
+
+  auto fill = MaskFill {a, width, left, top, shadow.color};
+  for (u32 i = 0; i < height; ++i)
+    setrow(canvas, top + i, left, left + width, fill);
+}
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "canvas.hh"
+#include "layer.hh"
+#include "list.hh"
+
+namespace PW {
+
+// `sigma` is the standard deviation of the Gaussian the blur approximates,
+// in pixels; `offset` is rounded to whole pixels.
+struct Shadow {
+  Point offset;
+  float sigma;
+  Pixel color;
+};
+
+// The blurred coverage of one layer. It has to stay alive until the frame is
+// resolved in tiled mode, so every shadowed layer keeps its own.
+struct ShadowMask {
+  List<u8> mask;
+  List<u8> scratch;
+  List<u32> sums;
+};
+
+// Composites the shadow of the layer's contents. Call it between push_layer
+// and pop_layer so that the layer lands on top of its shadow.
+void drop_shadow(Canvas& canvas, LayerPool const& pool, Layer const& layer, Shadow const& shadow, ShadowMask& mask);
+
+}
@@ -0,0 +1,188 @@
+#include "shape.hh"
+#include "fill.hh"
+#include "math.hh"
+
+#include <cmath>
+#include <cstdlib>
+#include <utility>
+
+namespace PW {
+
+namespace {
+
+// Gradient directions are normals to the iso-lines, so they map by the
+// inverse transpose of the linear part.
+Point normal(Affine const& m, Point d) {
+  auto det = m.xx * m.yy - m.xy * m.yx;
+  return Point {m.yy * d.x - m.yx * d.y, m.xx * d.y - m.xy * d.x} / det;
+}
+
+FillData transform_fill(u8 fill_type, FillData fill, Affine const& m, float scale) {
+  switch (fill_type) {
+    case RadialGradient::fill_type: {
+      auto& radial = reinterpret_cast<RadialGradient&>(fill);
+      radial.position = m(radial.position);
+      radial.start_radius *= scale;
+      radial.thickness *= scale;
+      break;
+    }
+    case LinearGradient::fill_type: {
+      auto& gradient = reinterpret_cast<LinearGradient&>(fill);
+      gradient.position = m(gradient.position);
+      gradient.direction = normal(m, gradient.direction);
+      break;
+    }
+    case LinearRamp::fill_type: {
+      auto& gradient = reinterpret_cast<LinearRamp&>(fill);
+      gradient.position = m(gradient.position);
+      gradient.direction = normal(m, gradient.direction);
+      break;
+    }
+    case RadialRamp::fill_type: {
+      auto& radial = reinterpret_cast<RadialRamp&>(fill);
+      radial.center = m(radial.center);
+      radial.start_radius *= scale;
+      radial.thickness *= scale;
+      break;
+    }
+    case Pattern::fill_type: {
+      // The pattern is placed in local space, so it samples through the
+      // inverse transform.
+      auto& pattern = reinterpret_cast<Pattern&>(fill);
+      auto det = m.xx * m.yy - m.xy * m.yx;
+      auto dx = pattern.dx * (m.yy / det) - pattern.dy * (m.yx / det);
+      auto dy = pattern.dy * (m.xx / det) - pattern.dx * (m.xy / det);
+      pattern.origin = pattern.origin - dx * m.x - dy * m.y;
+      pattern.dx = dx;
+      pattern.dy = dy;
+      break;
+    }
+    case Gouraud::fill_type: {
+      // Each weight is a plane sampled like a pattern.
+      auto& gouraud = reinterpret_cast<Gouraud&>(fill);
+      auto det = m.xx * m.yy - m.xy * m.yx;
+      float* planes[] {gouraud.u, gouraud.v};
+      for (auto plane: planes) {
+        auto dx = (plane[0] * m.yy - plane[1] * m.yx) / det;
+        auto dy = (plane[1] * m.xx - plane[0] * m.xy) / det;
+        plane[2] -= dx * m.x + dy * m.y;
+        plane[0] = dx;
+        plane[1] = dy;
+      }
+      break;
+    }
+  }
+  return fill;
+}
+
+}
+
+u16 add_point(Shape& shape, Point p) {
+  for (u32 k = 0; k < shape.point_count; ++k)
+    if (shape.x[k] == p.x && shape.y[k] == p.y)
+      return k;
+  check(shape.point_count < Shape::max_points);
+  shape.x[shape.point_count] = p.x;
+  shape.y[shape.point_count] = p.y;
+  return shape.point_count++;
+}
+
+u32 add_fill(Shape& shape, u8 fill_type, FillData const& fill) {
+  check(shape.fill_count < AllEdges::max_fills);
+  auto index = shape.fill_count++;
+  shape.fill_data[index] = fill;
+  shape.fill_type[index] = fill_type;
+  return index + 1;
+}
+
+void add_segment(Shape& shape, Point from, Point to, u32 fill_right, u32 fill_left) {
+  check(shape.segment_count < Shape::max_segments);
+  shape.segments[shape.segment_count++] = {add_point(shape, from), add_point(shape, to), fill_right, fill_left};
+}
+
+void add_arc(Shape& shape, Point center, float radius, Dir start, Dir end, u32 fill_inner, u32 fill_outer) {
+  check(shape.arc_count < Shape::max_arcs);
+  shape.arcs[shape.arc_count++] = {add_point(shape, center), radius, start, end, fill_inner, fill_outer};
+}
+
+void instance(AllEdges& edges, Shape const& shape, Affine const& m) {
+  float x[Shape::max_points];
+  float y[Shape::max_points];
+  auto count = shape.point_count;
+  for (u32 k = 0; k < count; ++k)
+    x[k] = m.xx * shape.x[k] + m.xy * shape.y[k] + m.x;
+  for (u32 k = 0; k < count; ++k)
+    y[k] = m.yx * shape.x[k] + m.yy * shape.y[k] + m.y;
+  auto at = [&](u16 k) { return Point {x[k], y[k]}; };
+
+  auto scale = sqrt(abs(m.xx * m.yy - m.xy * m.yx));
+  auto base = edges.fill_count;
+  for (u32 k = 0; k < shape.fill_count; ++k)
+    push_fill(edges, shape.fill_type[k], transform_fill(shape.fill_type[k], shape.fill_data[k], m, scale));
+  auto fill = [&](u32 index) { return index ? index + base : 0; };
+
+  // A mirror turns the outline around: what was right of a segment is left
+  // of it, and arcs run from their end to their start.
+  auto mirrored = m.xx * m.yy - m.xy * m.yx < 0.f;
+  for (u32 k = 0; k < shape.segment_count; ++k) {
+    auto const& segment = shape.segments[k];
+    auto right = fill(segment.fill_right);
+    auto left = fill(segment.fill_left);
+    if (mirrored)
+      std::swap(right, left);
+    push_line(edges, at(segment.from), at(segment.to), right, left);
+  }
+
+  if (shape.arc_count) {
+    check(abs(m.xx * m.xy + m.yx * m.yy) < 1e-3f * scale * scale);
+    check(abs(m.xx * m.xx + m.yx * m.yx - scale * scale) < 1e-3f * scale * scale);
+  }
+  auto turn = [&](Dir d) {
+    return Dir {(m.xx * d.x + m.xy * d.y) / scale, (m.yx * d.x + m.yy * d.y) / scale};
+  };
+  for (u32 k = 0; k < shape.arc_count; ++k) {
+    auto const& arc = shape.arcs[k];
+    auto start = turn(arc.start);
+    auto end = turn(arc.end);
+    if (mirrored)
+      std::swap(start, end);
+    push_arc(edges, at(arc.center), arc.radius * scale, start, end, fill(arc.fill_inner), fill(arc.fill_outer));
+  }
+}
+
+void push_line(AllEdges& edges, Point from, Point to, u32 fill_right, u32 fill_left) {
+  auto slope = (to.x - from.x) / (to.y - from.y);
+  if (to.y < from.y)
+    return push_edge(edges, to.y, from.y, fill_right, Line {from, slope});
+  push_edge(edges, from.y, to.y, fill_left, Line {from, slope});
+}
+
+void push_path_line(AllEdges& edges, Point from, Point to, u32 fill) {
+  auto slope = (to.x - from.x) / (to.y - from.y);
+  if (to.y < from.y)
+    return push_edge(edges, to.y, from.y, fill, Line {from, slope}, -1);
+  push_edge(edges, from.y, to.y, fill, Line {from, slope}, 1);
+}
+
+void push_arc(AllEdges& edges, Point center, float radius, Dir start, Dir end, u32 fill_inner, u32 fill_outer) {
+  auto r2 = radius * radius;
+  auto left = LeftArc {center, r2};
+  auto right = RightArc {center, r2};
+  if (start.x < 0.f && end.x > 0.f) {
+    push_edge(edges, center.y - radius, center.y + start.y * radius, fill_inner, left);
+    push_edge(edges, center.y - radius, center.y + end.y * radius, fill_outer, right);
+  } else if (start.x <= 0.f && end.x <= 0.f) {
+    check(start.y > end.y);
+    push_edge(edges, center.y + end.y * radius, center.y + start.y * radius, fill_inner, left);
+  } else if (start.x > 0.f && end.x < 0.f) {
+    push_edge(edges, center.y + end.y * radius, center.y + radius, fill_inner, left);
+    push_edge(edges, center.y + start.y * radius, center.y + radius, fill_outer, right);
+  } else if (start.x >= 0.f && end.x >= 0.f) {
+    check(end.y > start.y);
+    push_edge(edges, center.y + start.y * radius, center.y + end.y * radius, fill_outer, right);
+  } else {
+    abort();  // not a bug, this has unhandled cases for >180deg
+  }
+}
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "canvas.hh"
+#include "edges.hh"
+
+namespace PW {
+
+// p' = {xx * p.x + xy * p.y + x, yx * p.x + yy * p.y + y}
+struct Affine {
+  float xx, yx, xy, yy, x, y;
+  Point operator()(Point p) const { return {xx * p.x + xy * p.y + x, yx * p.x + yy * p.y + y}; }
+};
+
+inline auto rotation(Point position, Dir dir) -> Affine {
+  return {dir.x, dir.y, -dir.y, dir.x, position.x, position.y};
+}
+
+// Outline geometry built once in local space. Points are kept as separate x
+// and y arrays so that instancing transforms them in two flat loops;
+// segments and arcs refer to them by index. Fill indices are 1-based, as with
+// AllEdges, and 0 means no fill.
+struct Shape {
+  enum { max_points = 64, max_segments = 32, max_arcs = 16 };
+
+  struct Segment {
+    u16 from;
+    u16 to;
+    u32 fill_right;
+    u32 fill_left;
+  };
+
+  struct Arc {
+    u16 center;
+    float radius;
+    Dir start;
+    Dir end;
+    u32 fill_inner;
+    u32 fill_outer;
+  };
+
+  float x[max_points];
+  float y[max_points];
+  u32 point_count {};
+  FillData fill_data[AllEdges::max_fills];
+  u8 fill_type[AllEdges::max_fills];
+  u32 fill_count {};
+  Segment segments[max_segments];
+  u32 segment_count {};
+  Arc arcs[max_arcs];
+  u32 arc_count {};
+};
+
+u16 add_point(Shape& shape, Point p);
+u32 add_fill(Shape& shape, u8 fill_type, FillData const& fill);
+void add_segment(Shape& shape, Point from, Point to, u32 fill_right, u32 fill_left);
+void add_arc(Shape& shape, Point center, float radius, Dir start, Dir end, u32 fill_inner, u32 fill_outer);
+
+template <class T>
+u32 add_fill(Shape& shape, T const& fill) {
+  static_assert(sizeof(T) <= sizeof(FillData));
+  static_assert(alignof(T) <= alignof(FillData));
+  FillData data;
+  reinterpret_cast<T&>(data) = fill;
+  return add_fill(shape, T::fill_type, data);
+}
+
+// Appends the shape, placed by `transform`, to `edges`. Arcs require a
+// transform without shear or uneven scale; mirrors are fine.
+void instance(AllEdges& edges, Shape const& shape, Affine const& transform);
+
+void push_line(AllEdges& edges, Point from, Point to, u32 fill_right, u32 fill_left);
+void push_arc(AllEdges& edges, Point center, float radius, Dir start, Dir end, u32 fill_inner, u32 fill_outer);
+// A segment of a path filled by `fill`'s winding rule. Paths need not be
+// split into regions; they may overlap and cross themselves.
+void push_path_line(AllEdges& edges, Point from, Point to, u32 fill);
+
+}
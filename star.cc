@@ -1,8 +1,7 @@
 #include "canvas.hh"
 #include "math.hh"
+#include "polygon.hh"
 
-void blit_rectangle(Canvas& canvas, Point corner, Size size, Dir dir, Pixel color);
-void blit_rectangle(Canvas& canvas, Point corner, Size size, Dir dir, LinearGradient const& gradient);
 void blit_pie(Canvas& canvas, Point center, float radius, Dir start, Dir end, RadialGradient const& radial);
 
 namespace PW {
@@ -21,6 +20,11 @@ Point offset_corner(Point const& point, Dir const& dir0, Dir const& dir1, float
 auto m90(Dir d) -> Dir { return {d.y, -d.x}; }
 auto p90(Dir d) -> Dir { return {-d.y, d.x}; }
 
+void push_rectangle(Polygons& polygons, Point corner, Point side, Point up, LinearGradient const& fill) {
+  Point points[] {corner, corner + side, corner + side + up, corner + up};
+  push_polygon(polygons, points, 4, fill);
+}
+
 }
 
 void star(Canvas& canvas, Point center, float outer_radius, float inner_radius, Dir top) {
@@ -54,10 +58,12 @@ void star(Canvas& canvas, Point center, float outer_radius, float inner_radius,
     o[i] = offset_corner(o[i], -dir[i - 1], dir[i], half);
 
   auto rect_length = dot(o[1] - o[0], dir[0]);
+  Polygons sides;
   for (u32 i = 0; i < 10; i += 2)
-    blit_rectangle(canvas, o[i], {blur, rect_length}, m90(dir[i]), LinearGradient {color, o[i], m90(dir[i]) * (1.f / blur)});
+    push_rectangle(sides, o[i], m90(dir[i]) * blur, dir[i] * rect_length, LinearGradient {color, o[i], m90(dir[i]) * (1.f / blur)});
   for (u32 i = 1; i < 10; i += 2)
-    blit_rectangle(canvas, o[i], {rect_length, blur}, dir[i], LinearGradient {color, o[i] + p90(dir[i]) * blur, m90(dir[i]) * (1.f / blur)});
+    push_rectangle(sides, o[i], dir[i] * rect_length, p90(dir[i]) * blur, LinearGradient {color, o[i] + p90(dir[i]) * blur, m90(dir[i]) * (1.f / blur)});
+  blit_polygons(canvas, sides);
 
   blit_pie(canvas, o[0], blur, m90(dir[9]), m90(dir[0]), RadialGradient {color, o[0], blur, -blur});
   for (u32 i = 2; i < 10; i += 2)
@@ -65,11 +71,13 @@ void star(Canvas& canvas, Point center, float outer_radius, float inner_radius,
   for (u32 i = 1; i < 10; i += 2)
     blit_pie(canvas, o[i], blur, p90(dir[i]), p90(dir[i - 1]), RadialGradient {color, o[i], 0, blur});
 
-  for (u32 i = 0; i < 5; ++i)
-    blit_triangle(canvas, center, ii[i], o[2 * i], color);
-  for (u32 i = 0; i + 1 < 5; ++i)
-    blit_triangle(canvas, center, ii[i], o[2 * (i + 1)], color);
-  blit_triangle(canvas, center, ii[4], o[0], color);
+  // The interior is a kite for each point of the star.
+  Polygons interior;
+  for (u32 i = 0; i < 5; ++i) {
+    Point kite[] {center, ii[(i + 4) % 5], o[2 * i], ii[i]};
+    push_polygon(interior, kite, 4, Solid {color});
+  }
+  blit_polygons(canvas, interior);
 }
 
 }
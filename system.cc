@@ -3,24 +3,40 @@ extern "C" {
 }
 
 #include "canvas.hh"
+#include "capture.hh"
+#include "damage.hh"
+#include "draw-list.hh"
 #include "math.hh"
 #include "edges.hh"
+#include "fill.hh"
+#include "governor.hh"
+#include "layer.hh"
+#include "list.hh"
+#include "recorder.hh"
+#include "shadow.hh"
+#include "shape.hh"
+#include "text.hh"
+#include "tiles.hh"
 
-#include <ctime>
 #include <cstdio>
 #include <cstdlib>
+#include <climits>
 #include <cmath>
 #include <algorithm>
+#include <chrono>
+#include <iterator>
 #include <new>
 
 void triangle(Canvas& canvas, Point, Point, Point, Pixel color);
-void bezier(Canvas&, Point, Point, Point, Point);
+void bezier(Canvas&, Point, Point, Point, Point, u32 steps, bool antialiased);
 
 namespace PW {
 
-void roundRect(Canvas& canvas, Point position);
+Shape make_round_rect(Pixel color);
+void roundRect(Canvas& canvas, Shape const& shape, Point position, float t);
 void push_ring(struct AllEdges&, Point center, float inner_radius, float outer_radius, Dir begin, Dir end, Pixel color);
 void star(Canvas& canvas, Point center, float outer_radius, float inner_radius, Dir top);
+void circle(Canvas& canvas, Point center, float radius, Pixel color);
 
 }
 
@@ -30,143 +46,29 @@ using namespace PW;
 
 constexpr unsigned square_size = 32;
 
-using std::exchange;
-
-struct Blob {
-  Blob(): data() {}
-  Blob(unsigned size);
-  Blob(Blob const&) = delete;
-  Blob(Blob&& other): data(exchange(other.data, nullptr)) {}
-  Blob(Blob&& other, unsigned size);
-  ~Blob();
-  void operator=(Blob&& other) { data = exchange(other.data, nullptr); }
-  char& operator[](unsigned i) { return data[i]; }
-  char const& operator[](unsigned i) const { return data[i]; }
-
-private:
-  char* data;
-};
-
-Blob::Blob(unsigned size): data((char*) malloc(size)) {}
-
-Blob::Blob(Blob&& other, unsigned size):
-  data((char*) realloc(exchange(other.data, nullptr), size)) {}
-
-Blob::~Blob() { free(exchange(data, nullptr)); }
-
-template <class T>
-constexpr bool is_trivial = std::is_trivial_v<T>;
-
-template <class T>
-struct List {
-  static_assert(is_trivial<T>);
-  void push(T const& x) {
-    expand(count + 1);
-    begin()[count++] = x;
-  }
-  T const& operator[](u32 index) const { return begin()[index]; }
-  T* begin() { return reinterpret_cast<T*>(&data[0]); }
-  T const* begin() const { return reinterpret_cast<T const*>(&data[0]); }
-  T* end() { return begin() + count; }
-  T const* end() const { return begin() + count; }
-  friend u32 len(List const& list) { return list.count; }
-private:
-  Blob data;
-  u32 count {};
-  u32 capacity {};
-  T* at(u32 index) { return reinterpret_cast<T*>(&data[0]) + index; }
-  void expand(u32 needed) {
-    if (capacity >= needed)
-      return;
-    if (!capacity) {
-      capacity = needed;
-    } else {
-      while (capacity < needed)
-        capacity *= 2;
-    }
-    data = Blob(std::move(data), capacity * sizeof(T));
-  }
-};
+constexpr Pixel background {255, 255, 255, 255};
 
 void clear(Canvas& canvas) {
-  for (unsigned i = 0; i < canvas.height; ++i)
-    for (unsigned j = 0; j < canvas.width; ++j)
-      canvas.data[i * canvas.stride + j] = {255, 255, 255, 255};
+  auto const& clip = canvas.clip;
+  for (auto i = clip.y0; i < clip.y1; ++i)
+    for (auto j = clip.x0; j < clip.x1; ++j)
+      canvas.at(i, j) = background;
 }
 
-[[maybe_unused]] void randomSquare(Canvas& canvas) {
-  unsigned i0 = rand() % (canvas.height - square_size);
-  unsigned j0 = rand() % (canvas.width - square_size);
-  for (unsigned i = i0; i < i0 + square_size; ++i)
-    for (unsigned j = j0; j < j0 + square_size; ++j)
-      canvas.data[i * canvas.stride + j] = {255, (unsigned char)(rand() % 255)};
+// Xorshift, so that each System keeps its own sequence.
+[[maybe_unused]] u32 next_random(u32& seed) {
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
 }
 
-unsigned to_pixel(float coord, unsigned limit) {
-  auto grid = static_cast<int>(ceil(coord - .5));
-  return grid < 0 ? 0 : grid > limit ? limit : grid;
-}
-
-float sqr(float value) {
-  return value * value;
-}
-
-Pixel lerp(Pixel const& a, Pixel const& b, float t) {
-  Pixel c;
-  for (auto i = 0u; i < 4u; ++i)
-    c[i] = a[i] + (b[i] - a[i]) * t;
-  return c;
-}
-
-void circle(Canvas& canvas, Point center, float radius, Pixel color) {
-  int H = canvas.height;
-  int W = canvas.width;
-  auto cx = center.x;
-  auto cy = center.y;
-  auto outer_radius = radius + .5;
-  auto inner_radius = radius - .5;
-  auto outer_radius_squared = sqr(outer_radius);
-  auto inner_radius_squared = sqr(inner_radius);
-
-  auto edgeRange = [&](u32 i, u32 j1, u32 j2, float y2) {
-    for (auto j = j1; j < j2; ++j) {
-      auto x2 = sqr(j + .5f - cx);
-      auto point_radius = sqrt(x2 + y2);
-      auto t = point_radius - inner_radius;
-      auto& pixel = canvas.data[i * canvas.stride + j];
-      pixel = lerp(color, pixel, t);
-    }
-  };
-  auto edgeRow = [&](u32 i) {
-    auto y2 = sqr(i + .5f - cy);
-    auto width = sqrt(outer_radius_squared - y2);
-    auto j1 = to_pixel(cx - width, W);
-    auto j2 = to_pixel(cx + width, W);
-    edgeRange(i, j1, j2, y2);
-  };
-
-  auto i1 = to_pixel(cy - outer_radius, H);
-  auto i2 = to_pixel(cy - inner_radius, H);
-  auto i3 = to_pixel(cy + inner_radius, H);
-  auto i4 = to_pixel(cy + outer_radius, H);
-
-  for (auto i = i1; i < i2; ++i)
-    edgeRow(i);
-  for (auto i = i2; i < i3; ++i) {
-    auto y2 = sqr(i + .5f - cy);
-    auto outer_width = sqrt(outer_radius_squared - y2);
-    auto inner_width = sqrt(inner_radius_squared - y2);
-    auto j1 = to_pixel(cx - outer_width, W);
-    auto j2 = to_pixel(cx - inner_width, W);
-    auto j3 = to_pixel(cx + inner_width, W);
-    auto j4 = to_pixel(cx + outer_width, W);
-    edgeRange(i, j1, j2, y2);
-    for (auto j = j2; j < j3; ++j)
-      canvas.data[i * canvas.stride + j] = color;
-    edgeRange(i, j3, j4, y2);
-  }
-  for (auto i = i3; i < i4; ++i)
-    edgeRow(i);
+[[maybe_unused]] void randomSquare(Canvas& canvas, u32& seed) {
+  unsigned i0 = next_random(seed) % (canvas.height - square_size);
+  unsigned j0 = next_random(seed) % (canvas.width - square_size);
+  for (unsigned i = i0; i < i0 + square_size; ++i)
+    for (unsigned j = j0; j < j0 + square_size; ++j)
+      canvas.data[i * canvas.stride + j] = {255, (unsigned char)(next_random(seed) % 255)};
 }
 
 // SquirrelNoise5 by Squirrel Eiserloh
@@ -198,10 +100,17 @@ Pixel colorNoise(int position, unsigned int seed) {
                static_cast<u8>(noise(3 * position + 2, seed) % 255u)};
 }
 
+double now() {
+  using namespace std::chrono;
+  return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
 [[maybe_unused]] constexpr Pixel red {255, 255, 0, 0};
 [[maybe_unused]] constexpr Pixel blue {255, 50, 100, 255};
 [[maybe_unused]] constexpr Pixel light_red {255, 255, 127, 127};
 
+using StripSink = void (*)(void const* user, unsigned const* data, unsigned top, unsigned rows, unsigned stride);
+
 struct System {
   void (*redraw)(void const*);
 
@@ -217,61 +126,344 @@ struct System {
 
   u32 dragged_point = 0;
   float t = 0.f;
+  float round_rect_t = -.0625f;
+  Shape round_rect = make_round_rect({255, 255, 0, 0});
+
+  bool front_to_back = false;
+  bool tiled = false;
+  bool parallel = false;
+  bool fixed_point = false;
+  bool gamma_correct = false;
+  Tiles tiles;
+  DrawList draw_list;
+  Workers workers;
+  List<u16> occluded;
+  List<RowExtent> occluded_rows;
+
+  LayerPool layers;
+  Layer handles;
+  Layer star_layer;
+  ShadowMask star_shadow;
+  GlyphCache glyphs;
+
+  unsigned debug = 0;
+  u32 seed = 1;
+  Stats stats {};
+  List<u8> hits;
+  Capture* capturing = nullptr;
+  List<Pixel> strip;
+  bool exporting = false;
+  Recorder recorder;
+  bool track_changes = false;
+  Damage damage;
+
+  // Moves that arrive while a frame is already requested only replace
+  // `pending_move`; the latest one is applied when the frame is painted.
+  bool has_pending_move = false;
+  Point pending_move {};
+  bool requested = false;
+  u32 coalesced = 0;
+
+  // Paints start at most once per `interval`, or once per paint when painting
+  // takes longer. `input_time` is when the oldest input not yet painted
+  // arrived; `frame_input_time` is the same for the frame being presented.
+  double interval = 1. / 60.;
+  double paint_cost = 0.;
+  double last_paint = 0.;
+  double input_time = -1.;
+  double frame_input_time = -1.;
+  double latency = 0.;
+  u32 frames = 0;
+  Governor governor;
 
   static constexpr float handle_radius = 5.f;
 
-  void paint(unsigned* data, unsigned width, unsigned height, unsigned row) {
-    unsigned long start = clock();
-    Canvas canvas {reinterpret_cast<Pixel*>(data), width, height, row};
-    clear(canvas);
-    // randomSquare(canvas);
+  // Applies pending input and steps the animation, once per frame on screen.
+  void advance() {
+    applyPendingMove(nullptr);
+    requested = false;
+    frame_input_time = exchange(input_time, -1.);
+    round_rect_t += .0625f;
+    t += .1f;
+    invalidate(star_layer);
+    trim(glyphs);
+  }
 
+  // Scales the scene to the canvas height.
+  void layout(unsigned width, unsigned height) {
     if (width != size.x || height != size.y) {
       auto newSize = Size {static_cast<float>(height), static_cast<float>(height)};
       auto sizeChange = newSize / size;
       for (u32 i = 0; i < 4; ++i)
         p[i] = sizeChange * p[i];
       size = newSize;
+      invalidate(handles);
     }
+  }
 
-    roundRect(canvas, {100.f, 100.f});
+  void paint(unsigned* data, unsigned width, unsigned height, unsigned row) {
+    auto paint_start = now();
+    advance();
+    layout(width, height);
+    Canvas canvas {reinterpret_cast<Pixel*>(data), width, height, row};
+    canvas.fixed_point = fixed_point;
+    canvas.gamma_correct = gamma_correct;
+    // randomSquare(canvas, seed);
+
+    stats = {};
+    if (debug) {
+      if (debug & SysDebugHeatmap) {
+        hits.resize(width * height);
+        std::fill(hits.begin(), hits.end(), 0);
+        stats.hits = hits.begin();
+        stats.stride = width;
+      }
+      canvas.stats = &stats;
+    }
 
-    t += .1f;
+    // Captures record the scene in drawing order, so they use the normal path.
+    if (capturing) {
+      begin(*capturing, canvas);
+      canvas.capture = capturing;
+      clear(canvas);
+      record_clear(*capturing, background);
+      for (auto step: scene)
+        (this->*step)(canvas);
+      canvas.capture = nullptr;
+    } else if (tiled) {
+      begin(tiles, canvas, background);
+      canvas.tiles = &tiles;
+      for (auto step: scene)
+        (this->*step)(canvas);
+      canvas.tiles = nullptr;
+      resolve(tiles, canvas);
+    } else if (parallel) {
+      clear(canvas);
+      begin(draw_list);
+      canvas.draw_list = &draw_list;
+      for (auto step: scene)
+        (this->*step)(canvas);
+      canvas.draw_list = nullptr;
+      execute(draw_list, canvas, workers);
+    } else if (front_to_back)
+      paintFrontToBack(canvas);
+    else {
+      clear(canvas);
+      for (auto step: scene)
+        (this->*step)(canvas);
+    }
+
+    if (debug & SysDebugHeatmap)
+      draw_heatmap(canvas, stats);
+    stats.hits = nullptr;
+    if (track_changes)
+      update(damage, canvas);
+    else
+      skip(damage, canvas);
+    submit(recorder, canvas);
+
+//    triangle(canvas, t + 10.f);
+    auto cost = now() - paint_start;
+    paint_cost = frames ? paint_cost + (cost - paint_cost) / 8. : cost;
+    if (report(governor, cost))
+      invalidate(handles);
+    last_paint = paint_start;
+    frames += 1;
+    printf("paint %lu\n", static_cast<unsigned long>(cost * 1e6));
+  }
+
+  // Paints the frame in strips of `strip_height` rows, through one buffer of
+  // that many rows. Each strip canvas covers the whole frame, with its clip
+  // and `top` set to the strip, so the scene draws as it would in one piece.
+  // Every strip runs the whole scene again, building and sorting its edge
+  // lists anew; primitives outside the strip are culled by their bounds
+  // before any span is set up. So the cost of setup grows with the number of
+  // strips, and tall strips are cheaper when memory allows.
+  //
+  // An export leaves the session as it was: the animation and input stay put,
+  // and the layout is restored for the next paint on screen. Layers are cut
+  // to the frame, not the strip, so the handles, which span the frame, are
+  // drawn without one, and the layer buffers are freed afterwards.
+  void paintStrips(unsigned width, unsigned height, unsigned strip_height, StripSink sink, void const* user) {
+    auto saved_size = size;
+    Point saved_p[4];
+    std::copy(std::begin(p), std::end(p), saved_p);
+    layout(width, height);
+    release(layers, handles);
+    release(layers, star_layer);
+    exporting = true;
+    strip.resize(width * strip_height);
+    for (u32 top = 0; top < height; top += strip_height) {
+      auto rows = min(strip_height, height - top);
+      Canvas canvas {strip.begin(), width, height, width};
+      canvas.clip = {0, static_cast<int>(top), static_cast<int>(width), static_cast<int>(top + rows)};
+      canvas.top = top;
+      canvas.fixed_point = fixed_point;
+      canvas.gamma_correct = gamma_correct;
+      clear(canvas);
+      for (auto step: scene)
+        (this->*step)(canvas);
+      sink(user, reinterpret_cast<unsigned const*>(strip.begin()), top, rows, width);
+    }
+
+    exporting = false;
+    size = saved_size;
+    std::copy(std::begin(saved_p), std::end(saved_p), p);
+    release(layers, star_layer);
+    trim(layers);
+  }
+
+  bool capture(char const* path, unsigned* data, unsigned width, unsigned height, unsigned row) {
+    Capture captured;
+    capturing = &captured;
+    paint(data, width, height, row);
+    capturing = nullptr;
+    return save(captured, path);
+  }
+
+  // Asks the host for one frame; further requests before it is painted are
+  // folded into it.
+  void request(void const* user) {
+    if (requested)
+      return;
+    requested = true;
+    input_time = now();
+    redraw(user);
+  }
+
+  auto paintDelay() -> double {
+    auto next = last_paint + max(interval, paint_cost);
+    return max(0., next - now());
+  }
+
+  void presented() {
+    if (frame_input_time >= 0.)
+      latency = now() - frame_input_time;
+    frame_input_time = -1.;
+  }
+
+  // A pending move only exists while a frame is requested, so applying it
+  // never calls back into the host.
+  void applyPendingMove(void const* user) {
+    if (exchange(has_pending_move, false))
+      applyMove(user, pending_move);
+  }
+
+  // Opaque fills go front to back, claiming pixels in `occluded`. The
+  // background then only fills unclaimed pixels, and the translucent fills go
+  // back to front, skipping pixels claimed by a layer in front of them. Each
+  // step numbers its primitives from its own base layer, in both passes.
+  void paintFrontToBack(Canvas& canvas) {
+    static_assert(std::size(scene) < 1 << (16 - Occlusion::primitive_bits));
+    auto base = [](u32 step) { return static_cast<u16>((step + 1) << Occlusion::primitive_bits); };
+    auto stride = canvas.width;
+    if (len(occluded) != stride * canvas.height) {
+      occluded.resize(stride * canvas.height);
+      occluded_rows.resize(canvas.height);
+      std::fill(occluded.begin(), occluded.end(), 0);
+      std::fill(occluded_rows.begin(), occluded_rows.end(), RowExtent {~0u, 0});
+    }
+
+    Occlusion occlusion {occluded.begin(), occluded_rows.begin(), stride, 0, true};
+    canvas.occlusion = &occlusion;
+    for (auto k = std::size(scene); k--;) {
+      occlusion.layer = base(k);
+      (this->*scene[k])(canvas);
+    }
+    fill_background(canvas, background);
+    occlusion.opaque_pass = false;
+    for (auto k = 0u; k < std::size(scene); ++k) {
+      occlusion.layer = base(k);
+      (this->*scene[k])(canvas);
+    }
+    reset(occlusion, canvas.height);
+    canvas.occlusion = nullptr;
+  }
+
+  void drawRoundRect(Canvas& canvas) {
+    roundRect(canvas, round_rect, {100.f, 100.f}, round_rect_t);
+  }
+
+  void drawRing(Canvas& canvas) {
     auto dir0 = Dir {cos(t), sin(t)};
     auto dir1 = Dir {cos(1.1f * t), sin(1.1f * t)};
 
     AllEdges edges;
     push_ring(edges, {.5f * size.x, .5f * size.y}, 30.f, 36.f + 5.f * sin(1.2f * t), dir0, dir1, {255, 255, 0, 255});
     render(canvas, edges);
+  }
+
+  void drawTriangle(Canvas& canvas) {
+    auto dir0 = make_dir(.1f * t);
+    auto one_third = Dir {-.5f, .5f * sqrt(3.f)};
+    auto center = Point {.5f * canvas.width, .5f * canvas.height};
+    auto triangle_radius = .35f * canvas.width;
+    auto offset = dir0 * triangle_radius;
+    auto a0 = center + offset;
+    auto b0 = center + one_third * offset;
+    auto c0 = center + one_third * (one_third * offset);
+
+    auto a = a0 + make_dir(.5f * t) * 5.f;
+    auto b = b0 + make_dir(.8f * t + 1.f) * 5.f;
+    auto c = c0 + make_dir(.6f * t + 2.f) * 5.f;
+
+    if (governor.level >= SysQualityNoAntialiasing)
+      return blit_triangle(canvas, a, b, c, blue);
+    triangle(canvas, a, b, c, blue);
+  }
 
-    {
-      auto dir0 = make_dir(.1f * t);
-      auto one_third = Dir {-.5f, .5f * sqrt(3.f)};
-      auto center = Point {.5f * canvas.width, .5f * canvas.height};
-      auto triangle_radius = .35f * canvas.width;
-      auto offset = dir0 * triangle_radius;
-      auto a0 = center + offset;
-      auto b0 = center + one_third * offset;
-      auto c0 = center + one_third * (one_third * offset);
-
-      auto a = a0 + make_dir(.5f * t) * 5.f;
-      auto b = b0 + make_dir(.8f * t + 1.f) * 5.f;
-      auto c = c0 + make_dir(.6f * t + 2.f) * 5.f;
-
-      triangle(canvas, a, b, c, blue);
+  void drawBezier(Canvas& canvas) {
+    auto steps = governor.level >= SysQualityCoarseCurves ? 16 : 64;
+    bezier(canvas, p[0], p[1], p[2], p[3], steps, governor.level < SysQualityNoAntialiasing);
+  }
+
+  // The handles only change with the mouse and the quality level, so they are
+  // kept in a layer.
+  void drawHandles(Canvas& canvas) {
+    if (exporting)
+      return drawHandleCircles(canvas);
+    auto reach = handle_radius + 1.f;
+    auto bounds = Rect {INT_MAX, INT_MAX, INT_MIN, INT_MIN};
+    for (auto const& point: p) {
+      bounds.x0 = min(bounds.x0, static_cast<int>(floor(guard(point.x - reach))));
+      bounds.y0 = min(bounds.y0, static_cast<int>(floor(guard(point.y - reach))));
+      bounds.x1 = max(bounds.x1, static_cast<int>(ceil(guard(point.x + reach))));
+      bounds.y1 = max(bounds.y1, static_cast<int>(ceil(guard(point.y + reach))));
     }
-    bezier(canvas, p[0], p[1], p[2], p[3]);
 
-    if (over_handle[0])
+    Canvas group {};
+    if (push_layer(canvas, layers, handles, bounds, group))
+      drawHandleCircles(group);
+    pop_layer(canvas, layers, handles, 255);
+  }
+
+  void drawHandleCircles(Canvas& canvas) {
+    auto highlight = governor.level < SysQualityNoDecorations;
+    if (highlight && over_handle[0])
       circle(canvas, p[0], handle_radius, red);
-    if (over_handle[1])
+    if (highlight && over_handle[1])
       circle(canvas, p[3], handle_radius, red);
 
     circle(canvas, p[1], handle_radius, light_red);
     circle(canvas, p[2], handle_radius, light_red);
+  }
 
-    star(canvas, {200.f, 100.f}, 60.f, 25.f + 10.f * sin(.25f * t), make_dir(.1f * t));
+  void drawStar(Canvas& canvas) {
+    auto center = Point {200.f, 100.f};
+    auto outer_radius = 60.f;
+    auto reach = static_cast<int>(ceil(outer_radius + 1.f));
+    auto x = static_cast<int>(center.x);
+    auto y = static_cast<int>(center.y);
+
+    Canvas group {};
+    if (push_layer(canvas, layers, star_layer, {x - reach, y - reach, x + reach, y + reach}, group))
+      star(group, center, outer_radius, 25.f + 10.f * sin(.25f * t), make_dir(.1f * t));
+    if (governor.level < SysQualityNoDecorations)
+      drop_shadow(canvas, layers, star_layer, {{4.f, 6.f}, 4.f, {96, 0, 0, 0}}, star_shadow);
+    pop_layer(canvas, layers, star_layer, 255);
+  }
 
+  void drawCircles(Canvas& canvas) {
     for (auto i = 0u; i < len(circles); ++i) {
       auto& parameters = circles[i];
       auto radius = (noise(i, 0) % 100u + 20u) / 5.f;
@@ -279,11 +471,28 @@ struct System {
       auto color = colorNoise(i, 5);
       circle(canvas, center, radius, color);
     }
+  }
 
-//    triangle(canvas, t + 10.f);
-    printf("paint %lu\n", clock() - start);
+  void drawLabel(Canvas& canvas) {
+    char label[32];
+    snprintf(label, sizeof(label), "Frame %u", frames);
+    draw_text(canvas, glyphs, label, {10.f, canvas.height - 10.f}, 16.f, {255, 40, 40, 40});
   }
+
+  using Step = void (System::*)(Canvas&);
+  static constexpr Step scene[] {
+    &System::drawRoundRect,
+    &System::drawRing,
+    &System::drawTriangle,
+    &System::drawBezier,
+    &System::drawHandles,
+    &System::drawStar,
+    &System::drawCircles,
+    &System::drawLabel,
+  };
+
   void mouseDown(void const* user, Point location) {
+    applyPendingMove(user);
     if (over_handle[0]) {
       dragged_point = 1;
       return;
@@ -304,17 +513,29 @@ struct System {
     // circles.push({x, y});
   }
   void mouseUp(void const* user, Point location) {
+    applyPendingMove(user);
     printf("sys mouseup %f %f\n", location.x, location.y);
     dragged_point = 0;
     // circles.push({x, y});
   }
 
   void mouseMoved(void const* user, Point location) {
+    if (requested) {
+      coalesced += has_pending_move;
+      has_pending_move = true;
+      pending_move = location;
+      return;
+    }
+    applyMove(user, location);
+  }
+
+  void applyMove(void const* user, Point location) {
 
     if (dragged_point) {
       auto index = dragged_point - 1;
       p[index] = location;
-      return redraw(user);
+      invalidate(handles);
+      return request(user);
     }
 
     auto h0 = len(p[0] - location) < handle_radius;
@@ -329,8 +550,10 @@ struct System {
       over_handle[1] = h1;
       dirty = true;
     }
-    if (dirty)
-      redraw(user);
+    if (dirty) {
+      invalidate(handles);
+      request(user);
+    }
   }
 };
 
@@ -350,6 +573,94 @@ void sysKill(void* sys) {
 void sysPaint(void* sys, unsigned* data, unsigned width, unsigned height, unsigned stride) {
   return cast(sys)->paint(data, width, height, stride);
 }
+int sysStartRecording(void* sys, char const* path) {
+  return start(cast(sys)->recorder, path);
+}
+void sysStopRecording(void* sys) {
+  stop(cast(sys)->recorder);
+}
+void sysRecording(void* sys, SysRecording* out) {
+  auto& recorder = cast(sys)->recorder;
+  std::lock_guard lock {recorder.mutex};
+  out->recorded = recorder.recorded;
+  out->dropped = recorder.dropped;
+}
+void sysSetFrontToBack(void* sys, int enabled) {
+  cast(sys)->front_to_back = enabled;
+}
+void sysSetTiled(void* sys, int enabled) {
+  cast(sys)->tiled = enabled;
+}
+void sysSetParallel(void* sys, unsigned threads) {
+  auto& system = *cast(sys);
+  system.parallel = threads > 0;
+  start(system.workers, threads);
+}
+void sysSetFixedPoint(void* sys, int enabled) {
+  cast(sys)->fixed_point = enabled;
+}
+void sysSetGammaCorrect(void* sys, int enabled) {
+  cast(sys)->gamma_correct = enabled;
+}
+void sysSetTrackChanges(void* sys, int enabled) {
+  cast(sys)->track_changes = enabled;
+}
+void sysChanges(void* sys, SysChanges* out) {
+  auto const& damage = cast(sys)->damage;
+  out->tile_size = Damage::size;
+  out->columns = damage.columns;
+  out->rows = damage.rows;
+  out->changed = damage.changed_count;
+  out->bits = damage.changed.begin();
+}
+void sysSetDebug(void* sys, unsigned flags) {
+  cast(sys)->debug = flags;
+}
+void sysStats(void* sys, SysStats* out) {
+  auto const& stats = cast(sys)->stats;
+  out->primitives = stats.primitives;
+  out->edges = stats.edges;
+  out->spans = stats.spans;
+  for (auto i = 0u; i < Stats::max_fill_types; ++i)
+    out->pixels[i] = stats.pixels[i];
+  out->overdrawn = stats.overdrawn;
+}
+int sysPaintStrips(void* sys, unsigned width, unsigned height, unsigned strip_height, StripSink sink, void const* user) {
+  // Lists grow to under twice what they need, and their size in bytes must
+  // fit in a u32.
+  constexpr u32 max_strip_pixels = 1 << 28;
+  if (!width || !height || !strip_height || width > max_strip_pixels)
+    return 0;
+  strip_height = min(strip_height, min(height, max_strip_pixels / width));
+  cast(sys)->paintStrips(width, height, strip_height, sink, user);
+  return 1;
+}
+int sysCapture(void* sys, char const* path, unsigned* data, unsigned width, unsigned height, unsigned stride) {
+  return cast(sys)->capture(path, data, width, height, stride);
+}
+void sysSetFrameRate(void* sys, float frames_per_second) {
+  cast(sys)->interval = frames_per_second > 0.f ? 1. / frames_per_second : 0.;
+}
+void sysSetFrameBudget(void* sys, float milliseconds) {
+  auto& system = *cast(sys);
+  if (system.governor.level)
+    invalidate(system.handles);
+  set_budget(system.governor, milliseconds / 1000.);
+}
+double sysPaintDelay(void* sys) {
+  return cast(sys)->paintDelay();
+}
+void sysPresented(void* sys) {
+  cast(sys)->presented();
+}
+void sysTiming(void* sys, SysTiming* out) {
+  auto const& system = *cast(sys);
+  out->paint_ms = 1000. * system.paint_cost;
+  out->latency_ms = 1000. * system.latency;
+  out->frames = system.frames;
+  out->coalesced = system.coalesced;
+  out->quality = system.governor.level;
+}
 void sysMouseDown(void* sys, void const* user, float x, float y) {
   return cast(sys)->mouseDown(user, {x, y});
 }
@@ -0,0 +1,353 @@
+#include "text.hh"
+#include "edges.hh"
+#include "fill.hh"
+#include "math.hh"
+#include "shape.hh"
+
+#include <cmath>
+#include <cstdlib>
+#include <iterator>
+
+namespace PW {
+
+namespace {
+
+// The built-in font draws each character as strokes on a grid 4 wide and 6
+// tall, y down from the cap height to the baseline. Strokes are separated by
+// ';' and their points by spaces; a point starting with '*' is the control
+// point of a quadratic curve between its neighbours.
+struct Outline {
+  char c;
+  char const* strokes;
+};
+
+constexpr Outline font[] {
+  {' ', ""},
+  {'!', "2,0 2,4; 2,5.6 2,6"},
+  {'%', "0,6 4,0; 0.5,0.5 0.5,1; 3.5,5 3.5,5.5"},
+  {'(', "3,0 *1.5,3 3,6"},
+  {')', "1,0 *2.5,3 1,6"},
+  {'+', "0.5,3 3.5,3; 2,1.5 2,4.5"},
+  {',', "2,5.4 2,6 1.5,7"},
+  {'-', "1,3 3,3"},
+  {'.', "2,5.6 2,6"},
+  {'/', "0,6 4,0"},
+  {'0', "2,0 *4,0 4,2 4,4 *4,6 2,6 *0,6 0,4 0,2 *0,0 2,0; 3,1.5 1,4.5"},
+  {'1', "1,1 2,0 2,6; 1,6 3,6"},
+  {'2', "0,1.5 *0,0 2,0 *4,0 4,1.5 *4,3 2,4 0,6 4,6"},
+  {'3', "0,1 *0.5,0 2,0 *4,0 4,1.5 *4,3 2,3; 2,3 *4,3 4,4.5 *4,6 2,6 *0.5,6 0,5"},
+  {'4', "3,6 3,0 0,4 4,4"},
+  {'5', "4,0 0,0 0,3 2,3 *4,3 4,4.5 *4,6 2,6 *0.5,6 0,5"},
+  {'6', "3.5,0 *0,0.5 0,4 *0,6 2,6 *4,6 4,4.5 *4,3 2,3 *0,3 0,4.5"},
+  {'7', "0,0 4,0 1,6"},
+  {'8', "2,3 *0,3 0,1.5 *0,0 2,0 *4,0 4,1.5 *4,3 2,3 *0,3 0,4.5 *0,6 2,6 *4,6 4,4.5 *4,3 2,3"},
+  {'9', "0.5,6 *4,5.5 4,2 *4,0 2,0 *0,0 0,1.5 *0,3 2,3 *4,3 4,1.5"},
+  {':', "2,1.6 2,2; 2,5.6 2,6"},
+  {'=', "0.5,2 3.5,2; 0.5,4 3.5,4"},
+  {'?', "0,1.5 *0,0 2,0 *4,0 4,1.5 *4,3 2,3 2,4; 2,5.6 2,6"},
+  {'A', "0,6 2,0 4,6; 0.7,4 3.3,4"},
+  {'B', "0,0 2.5,0 *4,0 4,1.5 *4,3 2.5,3 0,3; 2.5,3 *4,3 4,4.5 *4,6 2.5,6 0,6 0,0"},
+  {'C', "4,1 *3.5,0 2,0 *0,0 0,2 0,4 *0,6 2,6 *3.5,6 4,5"},
+  {'D', "0,0 2,0 *4,0 4,2 4,4 *4,6 2,6 0,6 0,0"},
+  {'E', "4,0 0,0 0,6 4,6; 0,3 3,3"},
+  {'F', "4,0 0,0 0,6; 0,3 3,3"},
+  {'G', "4,1 *3.5,0 2,0 *0,0 0,2 0,4 *0,6 2,6 *4,6 4,4 4,3.5 2.5,3.5"},
+  {'H', "0,0 0,6; 4,0 4,6; 0,3 4,3"},
+  {'I', "1,0 3,0; 2,0 2,6; 1,6 3,6"},
+  {'J', "4,0 4,4 *4,6 2,6 *0,6 0,4.5"},
+  {'K', "0,0 0,6; 4,0 0,4; 1.3,2.8 4,6"},
+  {'L', "0,0 0,6 4,6"},
+  {'M', "0,6 0,0 2,3.5 4,0 4,6"},
+  {'N', "0,6 0,0 4,6 4,0"},
+  {'O', "2,0 *4,0 4,2 4,4 *4,6 2,6 *0,6 0,4 0,2 *0,0 2,0"},
+  {'P', "0,6 0,0 2.5,0 *4,0 4,1.5 *4,3 2.5,3 0,3"},
+  {'Q', "2,0 *4,0 4,2 4,4 *4,6 2,6 *0,6 0,4 0,2 *0,0 2,0; 2.5,4.5 4,6"},
+  {'R', "0,6 0,0 2.5,0 *4,0 4,1.5 *4,3 2.5,3 0,3; 2,3 4,6"},
+  {'S', "4,1 *3.5,0 2,0 *0,0 0,1.5 *0,3 2,3 *4,3 4,4.5 *4,6 2,6 *0.5,6 0,5"},
+  {'T', "0,0 4,0; 2,0 2,6"},
+  {'U', "0,0 0,4 *0,6 2,6 *4,6 4,4 4,0"},
+  {'V', "0,0 2,6 4,0"},
+  {'W', "0,0 1,6 2,2 3,6 4,0"},
+  {'X', "0,0 4,6; 4,0 0,6"},
+  {'Y', "0,0 2,3 4,0; 2,3 2,6"},
+  {'Z', "0,0 4,0 0,6 4,6"},
+};
+
+// In grid units: the stroke width, the space before the grid and the pen
+// advance. The cap height of 6 units is 0.7 em.
+constexpr float stroke_width = .8f;
+constexpr float bearing = .8f;
+constexpr float advance = 5.6f;
+constexpr float em_units = 6.f / .7f;
+
+// Each quadratic is flattened into this many lines, which keeps the busiest
+// glyph, '8', within the renderer's edge limit.
+constexpr u32 curve_pieces = 3;
+
+constexpr u32 supersample = 4;
+
+auto find_outline(char c) -> char const* {
+  if (c >= 'a' && c <= 'z')
+    c -= 'a' - 'A';
+  for (auto const& outline: font)
+    if (outline.c == c)
+      return outline.strokes;
+  return nullptr;
+}
+
+// A point of an outline as parsed; `last` ends its stroke.
+struct OutlinePoint {
+  Point p;
+  bool control;
+  bool last;
+};
+
+auto parse(char const* strokes, auto const& emit) {
+  while (*strokes) {
+    while (*strokes == ' ')
+      ++strokes;
+    auto control = *strokes == '*';
+    if (control)
+      ++strokes;
+    char* end;
+    auto x = strtof(strokes, &end);
+    check(*end == ',');
+    auto y = strtof(end + 1, &end);
+    while (*end == ' ')
+      ++end;
+    auto last = !*end || *end == ';';
+    emit(OutlinePoint {{x, y}, control, last});
+    strokes = *end == ';' ? end + 1 : end;
+  }
+}
+
+// Pushes a flattened stroke as one rectangle per piece, all wound the same
+// way so that overlaps merge under the non-zero rule. Open ends get square
+// caps. At joints each piece reaches the miter, but at most half the width
+// past the joint, which bevels the sharp corners; a stroke that ends where it
+// began joins there too.
+void push_stroke(AllEdges& edges, Point const* points, u32 count, float half_width, u32 fill) {
+  if (count < 2)
+    return;
+  auto pieces = count - 1;
+  auto closed = pieces > 1 && abs2(points[pieces] - points[0]) < 1e-6f;
+  auto direction = [&](u32 k) {
+    auto d = points[k + 1] - points[k];
+    auto length = len(d);
+    return length > 1e-4f ? d / length : Point {1.f, 0.f};
+  };
+  // tan(theta / 2) of the turn between unit directions `a` and `b`.
+  auto reach = [&](Point a, Point b) {
+    auto sine = abs(a.x * b.y - a.y * b.x);
+    auto cosine = dot(a, b);
+    return half_width * (cosine > -.999f ? min(1.f, sine / (1.f + cosine)) : 1.f);
+  };
+  for (u32 k = 0; k < pieces; ++k) {
+    auto d = direction(k);
+    auto before = k ? reach(direction(k - 1), d) : closed ? reach(direction(pieces - 1), d) : half_width;
+    auto after = k + 1 < pieces ? reach(d, direction(k + 1)) : closed ? reach(d, direction(0)) : half_width;
+    auto a = points[k] - d * before;
+    auto b = points[k + 1] + d * after;
+    auto n = Point {-d.y, d.x} * half_width;
+    Point corners[] {a + n, b + n, b - n, a - n};
+    for (u32 c = 0; c < 4; ++c)
+      push_path_line(edges, corners[c], corners[(c + 1) % 4], fill);
+  }
+}
+
+auto make_key(char c, u32 size, u32 offset) -> u32 { return size << 9 | offset << 7 | static_cast<u8>(c); }
+
+auto slot(u32 key) -> u32 { return (key * 2654435761u) >> 22; }
+
+static_assert(GlyphCache::table_size == 1 << 10);
+
+// Finds room on the current shelf, else on a new shelf, else on a new page.
+bool allocate(GlyphCache& cache, u32 width, u32 height, GlyphCache::Glyph& glyph) {
+  constexpr u32 page_size = GlyphCache::page_size;
+  if (width > page_size || height > page_size)
+    return false;
+  if (cache.shelf_x + width > page_size) {
+    cache.shelf_y += cache.shelf_height;
+    cache.shelf_x = 0;
+    cache.shelf_height = 0;
+  }
+  if (!len(cache.pages) || cache.shelf_y + height > page_size) {
+    auto page = static_cast<u8*>(malloc(page_size * page_size));
+    check(page);
+    cache.pages.push(page);
+    cache.shelf_x = 0;
+    cache.shelf_y = 0;
+    cache.shelf_height = 0;
+  }
+  glyph.page = len(cache.pages) - 1;
+  glyph.x = cache.shelf_x;
+  glyph.y = cache.shelf_y;
+  cache.shelf_x += width;
+  cache.shelf_height = max(cache.shelf_height, height);
+  return true;
+}
+
+// Draws the outline 4x4 supersampled with the edge renderer and averages
+// each block into the glyph's coverage.
+bool rasterize(GlyphCache& cache, char const* strokes, float unit, float offset, GlyphCache::Glyph& glyph) {
+  auto at = [&](Point p) { return Point {offset + (bearing + p.x) * unit, (p.y - 6.f) * unit}; };
+  auto reach = .75f * stroke_width * unit;
+  auto lo = Point {1e9f, 1e9f};
+  auto hi = Point {-1e9f, -1e9f};
+  parse(strokes, [&](OutlinePoint point) {
+    auto p = at(point.p);
+    lo = {min(lo.x, p.x - reach), min(lo.y, p.y - reach)};
+    hi = {max(hi.x, p.x + reach), max(hi.y, p.y + reach)};
+  });
+  if (lo.x > hi.x) {
+    glyph.width = glyph.height = 0;
+    return true;
+  }
+
+  auto left = static_cast<int>(floor(lo.x));
+  auto top = static_cast<int>(floor(lo.y));
+  auto width = static_cast<u32>(ceil(hi.x) - left);
+  auto height = static_cast<u32>(ceil(hi.y) - top);
+  if (!allocate(cache, width, height, glyph))
+    return false;
+  glyph.left = left;
+  glyph.top = top;
+  glyph.width = width;
+  glyph.height = height;
+
+  auto to_scratch = [&](Point p) {
+    auto q = at(p);
+    return Point {(q.x - left) * supersample, (q.y - top) * supersample};
+  };
+  AllEdges edges;
+  auto fill = push_fill(edges, Solid {{255, 255, 255, 255}});
+  auto half_width = .5f * stroke_width * unit * supersample;
+  // Flattened points of the stroke being read.
+  Point line[32];
+  u32 count = 0;
+  Point control {};
+  bool curve = false;
+  parse(strokes, [&](OutlinePoint point) {
+    auto p = to_scratch(point.p);
+    if (point.control) {
+      control = p;
+      curve = true;
+      return;
+    }
+    if (curve) {
+      auto from = line[count - 1];
+      for (u32 k = 1; k < curve_pieces; ++k) {
+        auto t = static_cast<float>(k) / curve_pieces;
+        auto s = 1.f - t;
+        check(count < std::size(line));
+        line[count++] = from * (s * s) + control * (2.f * s * t) + p * (t * t);
+      }
+    }
+    check(count < std::size(line));
+    line[count++] = p;
+    curve = false;
+    if (point.last) {
+      push_stroke(edges, line, count, half_width, fill);
+      count = 0;
+    }
+  });
+
+  auto sample_width = width * supersample;
+  auto sample_height = height * supersample;
+  cache.scratch.resize(sample_width * sample_height);
+  for (auto& pixel: cache.scratch)
+    pixel = {};
+  Canvas samples {cache.scratch.begin(), sample_width, sample_height, sample_width};
+  render(samples, edges);
+
+  auto out = cache.pages[glyph.page] + glyph.y * GlyphCache::page_size + glyph.x;
+  for (u32 i = 0; i < height; ++i) {
+    for (u32 j = 0; j < width; ++j) {
+      u32 sum = 0;
+      for (u32 y = 0; y < supersample; ++y) {
+        auto row = &cache.scratch[(i * supersample + y) * sample_width + j * supersample];
+        for (u32 x = 0; x < supersample; ++x)
+          sum += row[x].alpha;
+      }
+      out[i * GlyphCache::page_size + j] = (sum + 8) / 16;
+    }
+  }
+  return true;
+}
+
+auto lookup(GlyphCache& cache, char c, char const* strokes, u32 size, u32 offset) -> GlyphCache::Glyph const* {
+  if (!len(cache.table)) {
+    cache.table.resize(GlyphCache::table_size);
+    for (auto& entry: cache.table)
+      entry = 0;
+  }
+  auto key = make_key(c, size, offset);
+  auto k = slot(key);
+  for (; cache.table[k]; k = (k + 1) % GlyphCache::table_size)
+    if (cache.glyphs[cache.table[k] - 1].key == key)
+      return &cache.glyphs[cache.table[k] - 1];
+
+  GlyphCache::Glyph glyph {key};
+  auto unit = size * .25f / em_units;
+  if (!rasterize(cache, strokes, unit, offset * .25f, glyph))
+    return nullptr;
+  cache.glyphs.push(glyph);
+  // A full table stops caching until trim; the glyph is still drawn from the
+  // page it was just rasterized into.
+  if (len(cache.glyphs) < GlyphCache::table_size * 3 / 4)
+    cache.table[k] = len(cache.glyphs);
+  return &cache.glyphs[len(cache.glyphs) - 1];
+}
+
+}
+
+GlyphCache::~GlyphCache() {
+  for (auto page: pages)
+    free(page);
+}
+
+void trim(GlyphCache& cache) {
+  if (len(cache.pages) <= GlyphCache::max_pages && 2 * len(cache.glyphs) <= GlyphCache::table_size)
+    return;
+  for (u32 k = 1; k < len(cache.pages); ++k)
+    free(cache.pages[k]);
+  cache.pages.resize(min(len(cache.pages), 1u));
+  cache.glyphs.clear();
+  cache.table.clear();
+  cache.shelf_x = 0;
+  cache.shelf_y = 0;
+  cache.shelf_height = 0;
+}
+
+auto draw_text(Canvas& canvas, GlyphCache& cache, char const* text, Point origin, float size, Pixel color) -> Point {
+  auto quarters = static_cast<u32>(guard(max(size, 0.f)) * 4.f + .5f);
+  auto unit = quarters * .25f / em_units;
+  auto step = advance * unit;
+  auto baseline = static_cast<int>(floor(guard(origin.y) + .5f));
+  auto pen = origin.x;
+  for (; *text; ++text, pen += step) {
+    auto c = *text;
+    auto strokes = find_outline(c);
+    if (!strokes)
+      strokes = find_outline(c = '?');
+    if (!quarters || culled(canvas, {pen, baseline - 8.f * unit}, {pen + step + unit, baseline + 2.f * unit}))
+      continue;
+
+    auto x = floor(guard(pen));
+    auto offset = static_cast<u32>((pen - x) * 4.f) & 3;
+    auto glyph = lookup(cache, c, strokes, quarters, offset);
+    if (!glyph || !glyph->width)
+      continue;
+
+    count_primitive(canvas);
+    auto left = static_cast<int>(x) + glyph->left;
+    auto top = baseline + glyph->top;
+    auto data = cache.pages[glyph->page] + glyph->y * GlyphCache::page_size + glyph->x;
+    auto fill = MaskFill {data, GlyphCache::page_size, left, top, color};
+    for (u32 i = 0; i < glyph->height; ++i)
+      setrow(canvas, top + i, left, left + glyph->width, fill);
+  }
+  return {pen, origin.y};
+}
+
+}
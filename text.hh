@@ -0,0 +1,50 @@
+#pragma once
+
+#include "canvas.hh"
+#include "list.hh"
+
+namespace PW {
+
+// Coverage of rasterized glyphs, kept across frames. Each glyph is drawn once
+// per size and quarter-pixel horizontal offset into an 8-bit atlas page;
+// text then composites straight from the pages. Pages are never moved or
+// reused within a frame, since tiled and parallel paints read them only when
+// the frame is resolved, so the cache only shrinks in trim.
+struct GlyphCache {
+  enum { page_size = 512, max_pages = 4, table_size = 1024 };
+
+  struct Glyph {
+    u32 key;
+    u16 page;
+    u16 x;
+    u16 y;
+    u16 width;
+    u16 height;
+    short left;
+    short top;
+  };
+
+  GlyphCache() = default;
+  GlyphCache(GlyphCache const&) = delete;
+  ~GlyphCache();
+
+  List<u8*> pages;
+  List<Glyph> glyphs;
+  // Indices into `glyphs` plus one, by open addressing on the key.
+  List<u32> table;
+  u32 shelf_x {};
+  u32 shelf_y {};
+  u32 shelf_height {};
+  List<Pixel> scratch;
+};
+
+// Empties the cache once it has outgrown `max_pages` or its table is half
+// full. Call it between frames, never while one is being painted.
+void trim(GlyphCache& cache);
+
+// Draws ASCII text from `origin` on its baseline, `size` pixels to the em,
+// and returns where the next character would go. Lowercase draws as
+// uppercase; characters the font lacks draw as '?'.
+auto draw_text(Canvas& canvas, GlyphCache& cache, char const* text, Point origin, float size, Pixel color) -> Point;
+
+}
@@ -0,0 +1,151 @@
+#include "texture.hh"
+#include "fill.hh"
+#include "math.hh"
+
+#include <bit>
+#include <cstdint>
+
+namespace {
+
+auto average(Pixel a, Pixel b, Pixel c, Pixel d) -> Pixel {
+  Pixel result;
+  for (auto i = 0u; i < 4u; ++i)
+    result[i] = (a[i] + b[i] + c[i] + d[i] + 2) >> 2;
+  return result;
+}
+
+// Texel index for `i`, which may lie outside [0, size).
+int wrap(int i, int size, Spread spread) {
+  switch (spread) {
+    case Spread::pad:
+      return max(0, min(size - 1, i));
+    case Spread::repeat:
+      i %= size;
+      return i < 0 ? i + size : i;
+    case Spread::reflect: {
+      auto period = 2 * size;
+      i %= period;
+      if (i < 0)
+        i += period;
+      return i < size ? i : period - 1 - i;
+    }
+  }
+  return 0;
+}
+
+// Lerps all four channels of two pixels at once, two channels per multiply;
+// `f` is the weight of `b` out of 256.
+u32 mix(u32 a, u32 b, u32 f) {
+  auto g = 256 - f;
+  auto rb = ((a & 0xff00ff) * g + (b & 0xff00ff) * f) >> 8 & 0xff00ff;
+  auto ag = ((a >> 8 & 0xff00ff) * g + (b >> 8 & 0xff00ff) * f) & 0xff00ff00;
+  return rb | ag;
+}
+
+}
+
+void make_texture(Texture& texture, Pixel const* data, u32 width, u32 height, u32 stride) {
+  PW::check(width > 0 && height > 0);
+  texture.levels[0] = {data, width, height, stride};
+
+  u32 count = 1;
+  u32 total = 0;
+  for (auto w = width, h = height; (w > 1 || h > 1) && count < Texture::max_levels; ++count) {
+    w = max(w / 2, 1u);
+    h = max(h / 2, 1u);
+    total += w * h;
+  }
+  texture.storage.resize(total);
+  texture.level_count = count;
+
+  auto out = texture.storage.begin();
+  for (u32 k = 1; k < count; ++k) {
+    auto const& src = texture.levels[k - 1];
+    auto w = max(src.width / 2, 1u);
+    auto h = max(src.height / 2, 1u);
+    for (u32 i = 0; i < h; ++i) {
+      auto row0 = &src.data[2 * i * src.stride];
+      auto row1 = &src.data[min(2 * i + 1, src.height - 1) * src.stride];
+      for (u32 j = 0; j < w; ++j) {
+        auto j0 = 2 * j;
+        auto j1 = min(j0 + 1, src.width - 1);
+        out[i * w + j] = average(row0[j0], row0[j1], row1[j0], row1[j1]);
+      }
+    }
+    texture.levels[k] = {out, w, h, w};
+    out += w * h;
+  }
+}
+
+namespace PW {
+
+// Texture coordinates step in 16.16 fixed point. Each batch first computes
+// texel indices and weights into flat arrays, then fetches and filters.
+template <class Mix>
+void span(Pixel* out, u32 n, Point p, Pattern const& pattern) {
+  auto const& texture = *pattern.texture;
+  auto const& base = texture.levels[0];
+
+  // Minify from the level whose texels are about one pixel wide.
+  auto footprint = max(abs2(pattern.dx), abs2(pattern.dy));
+  u32 level = 0;
+  while (level + 1 < texture.level_count && footprint >= 4.f) {
+    footprint *= .25f;
+    ++level;
+  }
+  auto const& image = texture.levels[level];
+  auto sx = static_cast<float>(image.width) / base.width;
+  auto sy = static_cast<float>(image.height) / base.height;
+
+  auto bilinear = pattern.sampling == Sampling::bilinear;
+  auto center = bilinear ? .5f : 0.f;
+  auto to_fixed = [](float x) { return static_cast<int64_t>(guard(x) * 65536.f); };
+  auto u0 = to_fixed((pattern.origin.x + p.x * pattern.dx.x + p.y * pattern.dy.x) * sx - center);
+  auto v0 = to_fixed((pattern.origin.y + p.x * pattern.dx.y + p.y * pattern.dy.y) * sy - center);
+  auto du = to_fixed(pattern.dx.x * sx);
+  auto dv = to_fixed(pattern.dx.y * sy);
+
+  int w = image.width;
+  int h = image.height;
+  auto spread = pattern.spread;
+
+  constexpr u32 batch = 64;
+  int iu[batch];
+  int iv[batch];
+  u32 fu[batch];
+  u32 fv[batch];
+  for (u32 k0 = 0; k0 < n; k0 += batch) {
+    auto m = min(n - k0, batch);
+    for (u32 k = 0; k < m; ++k) {
+      auto u = u0 + static_cast<int64_t>(k0 + k) * du;
+      auto v = v0 + static_cast<int64_t>(k0 + k) * dv;
+      iu[k] = static_cast<int>(u >> 16);
+      iv[k] = static_cast<int>(v >> 16);
+      fu[k] = (u >> 8 & 0xff) + (u >> 7 & 1);
+      fv[k] = (v >> 8 & 0xff) + (v >> 7 & 1);
+    }
+
+    if (!bilinear) {
+      for (u32 k = 0; k < m; ++k) {
+        auto texel = image.data[wrap(iv[k], h, spread) * image.stride + wrap(iu[k], w, spread)];
+        Mix::blend(out[k0 + k], texel);
+      }
+      continue;
+    }
+
+    for (u32 k = 0; k < m; ++k) {
+      auto j0 = wrap(iu[k], w, spread);
+      auto j1 = wrap(iu[k] + 1, w, spread);
+      auto row0 = &image.data[wrap(iv[k], h, spread) * image.stride];
+      auto row1 = &image.data[wrap(iv[k] + 1, h, spread) * image.stride];
+      auto top = mix(std::bit_cast<u32>(row0[j0]), std::bit_cast<u32>(row0[j1]), fu[k]);
+      auto bottom = mix(std::bit_cast<u32>(row1[j0]), std::bit_cast<u32>(row1[j1]), fu[k]);
+      Mix::blend(out[k0 + k], std::bit_cast<Pixel>(mix(top, bottom, fv[k])));
+    }
+  }
+}
+
+template void span<Srgb>(Pixel* out, u32 n, Point p, Pattern const& pattern);
+template void span<Linear>(Pixel* out, u32 n, Point p, Pattern const& pattern);
+
+}
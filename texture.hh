@@ -0,0 +1,23 @@
+#pragma once
+
+#include "canvas.hh"
+#include "list.hh"
+
+// A source image and its mip chain. The first level is the image itself and
+// is not copied; every further level halves both sides, down to 1x1.
+struct Texture {
+  enum { max_levels = 16 };
+
+  struct Level {
+    Pixel const* data;
+    u32 width;
+    u32 height;
+    u32 stride;
+  };
+
+  Level levels[max_levels];
+  u32 level_count {};
+  PW::List<Pixel> storage;
+};
+
+void make_texture(Texture& texture, Pixel const* data, u32 width, u32 height, u32 stride);
@@ -0,0 +1,158 @@
+#include "tiles.hh"
+#include "fill.hh"
+
+#include <bit>
+#include <cstring>
+
+namespace PW {
+
+namespace {
+
+constexpr u32 size = Tiles::size;
+
+bool same(Pixel a, Pixel b) {
+  return std::bit_cast<u32>(a) == std::bit_cast<u32>(b);
+}
+
+u32 extent(u32 total, u32 index) {
+  return min(size, total - index * size);
+}
+
+bool covered(Tiles const& tiles, Tiles::State const& state, u32 tile) {
+  auto w = extent(tiles.width, tile % tiles.columns);
+  auto h = extent(tiles.height, tile / tiles.columns);
+  auto row = static_cast<u16>((1u << w) - 1);
+  for (u32 r = 0; r < h; ++r)
+    if ((state.mask[r] & row) != row)
+      return false;
+  return true;
+}
+
+u32 push_fill(Tiles& tiles, u8 fill_type, FillData const& fill) {
+  auto count = len(tiles.fill_data);
+  if (count && tiles.fill_type[count - 1] == fill_type &&
+      !memcmp(&tiles.fill_data[count - 1], &fill, sizeof(FillData)))
+    return count - 1;
+  tiles.fill_data.push(fill);
+  tiles.fill_type.push(fill_type);
+  return count;
+}
+
+}
+
+void begin(Tiles& tiles, Canvas const& canvas, Pixel background) {
+  tiles.width = canvas.width;
+  tiles.height = canvas.height;
+  tiles.columns = (canvas.width + size - 1) / size;
+  tiles.rows = (canvas.height + size - 1) / size;
+  tiles.commands.clear();
+  tiles.fill_data.clear();
+  tiles.fill_type.clear();
+  tiles.states.resize(tiles.columns * tiles.rows);
+  for (auto& state: tiles.states) {
+    for (auto& row: state.mask)
+      row = 0xffff;
+    state.color = background;
+    state.base = background;
+    state.first = 0;
+  }
+}
+
+void bin(Tiles& tiles, u32 i, u32 j0, u32 j1, u8 fill_type, FillData const& fill) {
+  j1 = min(j1, tiles.width);
+  if (i >= tiles.height || j0 >= j1)
+    return;
+
+  auto fill_index = push_fill(tiles, fill_type, fill);
+  auto opaque = fill_type == Solid::fill_type && fill_cast<Solid>(fill).color.alpha == 255;
+  auto color = fill_cast<Solid>(fill).color;
+  auto r = i % size;
+  auto tile_row = i / size * tiles.columns;
+
+  for (auto tx = j0 / size; tx <= (j1 - 1) / size; ++tx) {
+    auto x0 = tx * size;
+    auto begin = max(j0, x0) - x0;
+    auto end = min(j1, x0 + size) - x0;
+    auto tile = tile_row + tx;
+    tiles.commands.push({tile, fill_index, static_cast<u8>(r), static_cast<u8>(begin), static_cast<u8>(end)});
+
+    auto bits = static_cast<u16>((1u << end) - (1u << begin));
+    auto& state = tiles.states[tile];
+    if (!opaque) {
+      state.mask[r] &= ~bits;
+      continue;
+    }
+    if (!same(state.color, color)) {
+      for (auto& row: state.mask)
+        row = 0;
+      state.color = color;
+    }
+    state.mask[r] |= bits;
+    if (covered(tiles, state, tile)) {
+      state.base = color;
+      state.first = len(tiles.commands);
+    }
+  }
+}
+
+void resolve(Tiles& tiles, Canvas& canvas) {
+  auto count = tiles.columns * tiles.rows;
+  auto& offsets = tiles.offsets;
+  offsets.resize(count);
+  std::fill(offsets.begin(), offsets.end(), 0);
+
+  auto commands = len(tiles.commands);
+  for (u32 k = 0; k < commands; ++k) {
+    auto const& command = tiles.commands[k];
+    if (k >= tiles.states[command.tile].first)
+      offsets[command.tile] += 1;
+  }
+  u32 total = 0;
+  for (auto& offset: offsets)
+    total += std::exchange(offset, total);
+  tiles.sorted.resize(total);
+  for (u32 k = 0; k < commands; ++k) {
+    auto const& command = tiles.commands[k];
+    if (k >= tiles.states[command.tile].first)
+      tiles.sorted[offsets[command.tile]++] = command;
+  }
+
+  Pixel local[size * size];
+  for (u32 tile = 0; tile < count; ++tile) {
+    auto x0 = tile % tiles.columns * size;
+    auto y0 = tile / tiles.columns * size;
+    auto w = extent(tiles.width, x0 / size);
+    auto h = extent(tiles.height, y0 / size);
+    auto base = tiles.states[tile].base;
+    auto out = &canvas.data[y0 * canvas.stride + x0];
+    auto first = tile ? offsets[tile - 1] : 0;
+    auto last = offsets[tile];
+
+    if (first == last) {
+      for (u32 r = 0; r < h; ++r)
+        for (u32 c = 0; c < w; ++c)
+          out[r * canvas.stride + c] = base;
+      continue;
+    }
+
+    for (auto& pixel: local)
+      pixel = base;
+    for (auto k = first; k < last; ++k) {
+      auto const& command = tiles.sorted[k];
+      auto p = Point {x0 + command.begin + .5f, y0 + command.row + .5f};
+      auto out = &local[command.row * size + command.begin];
+      auto n = command.end - command.begin;
+      auto fill_type = tiles.fill_type[command.fill];
+      auto const& fill = tiles.fill_data[command.fill];
+      if (canvas.gamma_correct)
+        span<Linear>(out, n, p, fill_type, fill);
+      else
+        span(out, n, p, fill_type, fill);
+    }
+    for (u32 r = 0; r < h; ++r)
+      for (u32 c = 0; c < w; ++c)
+        out[r * canvas.stride + c] = local[r * size + c];
+  }
+}
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "canvas.hh"
+#include "edges.hh"
+#include "list.hh"
+
+namespace PW {
+
+// Tiled mode. Spans are binned into per-tile commands instead of being
+// written, then each tile is rasterized into a small local buffer and written
+// back once. A tile that ends up fully covered by one opaque color drops the
+// commands under it and is filled directly.
+struct Tiles {
+  enum { size = 16 };
+
+  struct Command {
+    u32 tile;
+    u32 fill;
+    u8 row;
+    u8 begin;
+    u8 end;
+  };
+
+  // `mask` marks the pixels last written by an opaque span of `color`. Once
+  // it covers the tile, replay can start from `base` at command `first`.
+  struct State {
+    u16 mask[size];
+    Pixel color;
+    Pixel base;
+    u32 first;
+  };
+
+  u32 width {};
+  u32 height {};
+  u32 columns {};
+  u32 rows {};
+  List<Command> commands;
+  List<FillData> fill_data;
+  List<u8> fill_type;
+  List<State> states;
+  List<u32> offsets;
+  List<Command> sorted;
+};
+
+void begin(Tiles& tiles, Canvas const& canvas, Pixel background);
+void bin(Tiles& tiles, u32 i, u32 j0, u32 j1, u8 fill_type, FillData const& fill);
+void resolve(Tiles& tiles, Canvas& canvas);
+
+}
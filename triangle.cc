@@ -1,5 +1,7 @@
 #include "canvas.hh"
+#include "fill.hh"
 #include "math.hh"
+#include "polygon.hh"
 
 #include <cmath>
 #include <cstdio>
@@ -9,146 +11,62 @@ using namespace PW;
 
 namespace {
 
-using std::exchange;
-
-void check(bool condition) {
-  if (!condition)
-    abort();
-}
-
-void setrow(Canvas& canvas, u32 i, u32 j1, u32 j2, Pixel color) {
-  for (u32 j = j1; j < j2; ++j)
-    canvas.data[i * canvas.stride + j] = color;
-}
-
-// dedup
-Pixel lerp(Pixel const& a, Pixel const& b, float t) {
-  Pixel c;
-  for (auto i = 0u; i < 4u; ++i)
-    c[i] = a[i] + (b[i] - a[i]) * t;
-  return c;
-}
-
-void setrow(Canvas& canvas, u32 i, u32 j0, u32 j1, LinearGradient const& gradient) {
-  for (u32 j = j0; j < j1; ++j) {
-    auto p = Point {j + .5f, i + .5f};
-    auto t = max(0.f, min(1.f, dot(p - gradient.position, gradient.direction)));
-    auto& curr = canvas.data[i * canvas.stride + j];
-    curr = lerp(gradient.color, curr, t);
-  }
-}
-
-void setrow(Canvas& canvas, u32 i, u32 j0, u32 j1, RadialGradient const& radial) {
-  for (u32 j = j0; j < j1; ++j) {
-    auto p = Point {j + .5f, i + .5f};
-    auto t = max(0.f, min(1.f, (len(p - radial.position) - radial.start_radius) / radial.thickness));
-    auto& curr = canvas.data[i * canvas.stride + j];
-    curr = lerp(curr, radial.color, t);
-  }
-}
-
 // dedup
 float sqr(float value) { return value * value; }
 
 int tmp_to_pixel(float coord) {
-  return static_cast<int>(ceil(coord - .5f));
-}
-
-void blit_triangle_fragment(Canvas& canvas, Point anchor, float left_slope, float right_slope, u32 i0, u32 i1, auto const& fill) {
-  for (auto i = i0; i < i1; ++i) {
-    auto y = i + .5f - anchor.y;
-    auto j1 = tmp_to_pixel(anchor.x + y * left_slope);
-    auto j2 = tmp_to_pixel(anchor.x + y * right_slope);
-    setrow(canvas, i, j1, j2, fill);
-  }
-}
-
-void blit_top_rectangle(Canvas& canvas, float x0, float y0, float dx, float dy, float s0, float s1, auto const& fill) {
-  check(dx >= 0.f);
-  check(dy >= 0.f);
-
-  auto dx0 = s0 * dx;
-  auto dy0 = s0 * dy;
-  auto dx1 = -s1 * dy;
-  auto dy1 = s1 * dx;
-
-  auto slope0 = dx / dy;
-  auto slope1 = -dy / dx;
-
-  auto y1 = y0 + dy0;
-  auto y2 = y0 + dy1;
-  auto y3 = y2 + dy0;
-  auto x1 = x0 + dx0;
-  auto x2 = x0 + dx1;
-  auto x3 = x1 + dx1;
-
-  auto i0 = tmp_to_pixel(y0);
-  auto ia = tmp_to_pixel(y1);
-  auto ib = tmp_to_pixel(y2);
-  auto i3 = tmp_to_pixel(y3);
-
-  auto i1 = min(ia, ib);
-  auto i2 = max(ia, ib);
-
-  blit_triangle_fragment(canvas, {x0, y0}, slope1, slope0, i0, i1, fill);
-
-  auto yref = ia < ib ? y1 : y2;
-  auto x0ref = ia < ib ? x0 + slope1 * (s0 * dy) : x2;
-  auto x1ref = ia < ib ? x1 : x0 + slope0 * (s1 * dx);
-  auto slope = ia < ib ? slope1 : slope0;
-  for (auto i = i1; i < i2; ++i) {
-    auto dy = i + .5f - yref;
-    auto j0 = tmp_to_pixel(x0ref + dy * slope);
-    auto j1 = tmp_to_pixel(x1ref + dy * slope);
-    setrow(canvas, i, j0, j1, fill);
+  return static_cast<int>(ceil(guard(coord) - .5f));
+}
+
+// Emits the spans between `left` and `right`, evaluated a band of rows at a
+// time into a small span table.
+void ream(Canvas& canvas, int i0, int i1, float origin_y, auto const& left, auto const& right, auto const& fill) {
+  for (auto band = clip_row(canvas, i0), end = clip_row(canvas, i1); band < end; band += band_rows) {
+    int j0[band_rows];
+    int j1[band_rows];
+    for (auto r = 0; r < band_rows; ++r) {
+      auto y = band + r + .5f - origin_y;
+      j0[r] = tmp_to_pixel(left(y));
+      j1[r] = tmp_to_pixel(right(y));
+    }
+    for (auto i = band, rows_end = min(band + band_rows, end); i < rows_end; ++i)
+      setrow(canvas, i, j0[i - band], j1[i - band], fill);
   }
-  blit_triangle_fragment(canvas, {x3, y3}, slope0, slope1, i2, i3, fill);
 }
 
 auto p90(Dir d) -> Dir { return {-d.y, d.x}; }
 auto m90(Dir d) -> Dir { return {d.y, -d.x}; }
 
 void blit_rectangle_fill(Canvas& canvas, Point corner, float w, float h, Dir dir, auto const& fill) {
-  auto x = corner.x;
-  auto y = corner.y;
-  if (dir.x < 0 && dir.y < 0)
-    return blit_top_rectangle(canvas, x + w * dir.x - h * dir.y, y + w * dir.y + h * dir.x, -dir.x, -dir.y, w, h, fill);
-  if (dir.y < 0)
-    return blit_top_rectangle(canvas, x + w * dir.x, y + w * dir.y, -dir.y, dir.x, h, w, fill);
-  if (dir.x < 0)
-    return blit_top_rectangle(canvas, x - h * dir.y, y + h * dir.x, dir.y, -dir.x, h, w, fill);
-  return blit_top_rectangle(canvas, x, y, dir.x, dir.y, w, h, fill);
+  auto side = dir * w;
+  auto up = p90(dir) * h;
+  Point points[] {corner, corner + side, corner + side + up, corner + up};
+  blit_polygon(canvas, points, 4, fill);
 }
 
-void blit_top_triangle(Canvas& canvas, Point a, Point b, Point c, auto const& fill) {
-  auto i0 = tmp_to_pixel(a.y);
-  auto i1 = tmp_to_pixel(b.y);
-  auto i2 = tmp_to_pixel(c.y);
-  auto ab = (b.x - a.x) / (b.y - a.y);
-  auto ac = (c.x - a.x) / (c.y - a.y);
-  auto bc = (c.x - b.x) / (c.y - b.y);
-  if (ab < ac) {
-    blit_triangle_fragment(canvas, a, ab, ac, i0, i1, fill);
-    blit_triangle_fragment(canvas, c, bc, ac, i1, i2, fill);
-  } else {
-    blit_triangle_fragment(canvas, a, ac, ab, i0, i1, fill);
-    blit_triangle_fragment(canvas, c, ac, bc, i1, i2, fill);
-  }
+void blit_triangle_fill(Canvas& canvas, Point a, Point b, Point c, auto const& fill) {
+  Point points[] {a, b, c};
+  blit_polygon(canvas, points, 3, fill);
 }
 
-void blit_triangle_fill(Canvas& canvas, Point a, Point b, Point c, auto const& fill) {
-  if (a.y < b.y) {
-    if (b.y < c.y)
-      return blit_top_triangle(canvas, a, b, c, fill);
-    else if (a.y < c.y)
-      return blit_top_triangle(canvas, a, c, b, fill);
-    return blit_top_triangle(canvas, c, a, b, fill);
-  }
-  if (a.y < c.y)
-    return blit_top_triangle(canvas, b, a, c, fill);
-  if (b.y < c.y)
-    return blit_top_triangle(canvas, b, c, a, fill);
-  return blit_top_triangle(canvas, c, b, a, fill);
+// The planes over the triangle of the weights of b and c, all 0 when the
+// triangle has no area.
+struct Weights {
+  float u[3];
+  float v[3];
+};
+
+auto weights(Point a, Point b, Point c) -> Weights {
+  auto ab = b - a;
+  auto ac = c - a;
+  auto area = ab.x * ac.y - ab.y * ac.x;
+  if (area == 0.f)
+    return {};
+  auto ux = ac.y / area;
+  auto uy = -ac.x / area;
+  auto vx = -ab.y / area;
+  auto vy = ab.x / area;
+  return {{ux, uy, -(a.x * ux + a.y * uy)}, {vx, vy, -(a.x * vx + a.y * vy)}};
 }
 
 auto cross(Dir a, Dir b) {
@@ -176,14 +94,37 @@ Triangle inset_triangle(Triangle triangle, float inset) {
 }
 
 void blit_triangle(Canvas& canvas, Point a, Point b, Point c, Pixel color) {
-  blit_triangle_fill(canvas, a, b, c, color);
+  blit_triangle_fill(canvas, a, b, c, Solid {color});
 }
 
 void blit_triangle(Canvas& canvas, Point a, Point b, Point c, LinearGradient const& gradient) {
   blit_triangle_fill(canvas, a, b, c, gradient);
 }
 
+void blit_triangle(Canvas& canvas, Point a, Point b, Point c, Pixel color_a, Pixel color_b, Pixel color_c) {
+  blit_triangle_fill(canvas, a, b, c, make_gouraud(a, b, c, color_a, color_b, color_c));
+}
+
+// The texel coordinates are interpolated by the same weights as colors, which
+// for an affine mapping is just a pattern.
+void blit_triangle(Canvas& canvas, Point a, Point b, Point c, Texture const& texture, Point texel_a, Point texel_b, Point texel_c) {
+  auto [u, v] = weights(a, b, c);
+  auto du = texel_b - texel_a;
+  auto dv = texel_c - texel_a;
+  Pattern pattern {&texture, texel_a + du * u[2] + dv * v[2], du * u[0] + dv * v[0], du * u[1] + dv * v[1],
+    Spread::pad, Sampling::bilinear};
+  blit_triangle_fill(canvas, a, b, c, pattern);
+}
+
+auto make_gouraud(Point a, Point b, Point c, Pixel color_a, Pixel color_b, Pixel color_c) -> Gouraud {
+  auto [u, v] = weights(a, b, c);
+  return {{color_a, color_b, color_c}, {u[0], u[1], u[2]}, {v[0], v[1], v[2]}};
+}
+
 void blit_pie_fill(Canvas& canvas, Point c, float r, Dir dir0, Dir dir1, auto const& fill) {
+  if (culled(canvas, {c.x - r, c.y - r}, {c.x + r, c.y + r}))
+    return;
+  count_primitive(canvas);
   auto cx = c.x;
   auto cy = c.y;
   auto r2 = sqr(r);
@@ -211,11 +152,8 @@ void blit_pie_fill(Canvas& canvas, Point c, float r, Dir dir0, Dir dir1, auto co
   //   }
   // };
 
-  auto ream = [&](u32 i0, u32 i1, auto& left, auto& right) {
-    for (auto i = i0; i < i1; ++i) {
-      auto y = i + .5f - cy;
-      setrow(canvas, i, tmp_to_pixel(left(y)), tmp_to_pixel(right(y)), fill);
-    }
+  auto ream = [&](int i0, int i1, auto& left, auto& right) {
+    ::ream(canvas, i0, i1, cy, left, right, fill);
   };
 
   ream(dir1.x < dir0.x ? max(i_mid, i0) : i_mid, i1, edge1, arc1);
@@ -270,7 +208,7 @@ void triangle(Canvas& canvas, Point a, Point b, Point c, Pixel color) {
 }
 
 void blit_rectangle(Canvas& canvas, Point corner, Size size, Dir dir, Pixel color) {
-  blit_rectangle_fill(canvas, corner, size.x, size.y, dir, color);
+  blit_rectangle_fill(canvas, corner, size.x, size.y, dir, Solid {color});
 }
 
 void blit_rectangle(Canvas& canvas, Point corner, Size size, Dir dir, LinearGradient const& gradient) {
@@ -278,7 +216,7 @@ void blit_rectangle(Canvas& canvas, Point corner, Size size, Dir dir, LinearGrad
 }
 
 void blit_pie(Canvas& canvas, Point center, float radius, Dir start, Dir end, Pixel color) {
-  blit_pie_fill(canvas, center, radius, start, end, color);
+  blit_pie_fill(canvas, center, radius, start, end, Solid {color});
 }
 
 void blit_pie(Canvas& canvas, Point center, float radius, Dir start, Dir end, RadialGradient const& radial) {